@@ -45,13 +45,146 @@ int icache_status (void)
 	return i;
 }
 
+/*
+ * Cache geometry.  The line length in xparameters.h is given in words;
+ * without it fall back to one word, which is always correct, just slow.
+ */
+#if defined(XILINX_DCACHE_BYTE_SIZE)
+# define DCACHE_SIZE	XILINX_DCACHE_BYTE_SIZE
+#elif defined(XPAR_MICROBLAZE_DCACHE_BYTE_SIZE)
+# define DCACHE_SIZE	XPAR_MICROBLAZE_DCACHE_BYTE_SIZE
+#else
+# define DCACHE_SIZE	32768
+#endif
+
+#if defined(XILINX_ICACHE_BYTE_SIZE)
+# define ICACHE_SIZE	XILINX_ICACHE_BYTE_SIZE
+#elif defined(XPAR_MICROBLAZE_CACHE_BYTE_SIZE)
+# define ICACHE_SIZE	XPAR_MICROBLAZE_CACHE_BYTE_SIZE
+#else
+# define ICACHE_SIZE	32768
+#endif
+
+#if defined(XPAR_MICROBLAZE_DCACHE_LINE_LEN)
+# define DCACHE_LINE	(XPAR_MICROBLAZE_DCACHE_LINE_LEN * 4)
+#else
+# define DCACHE_LINE	4
+#endif
+
+#if defined(XPAR_MICROBLAZE_ICACHE_LINE_LEN)
+# define ICACHE_LINE	(XPAR_MICROBLAZE_ICACHE_LINE_LEN * 4)
+#else
+# define ICACHE_LINE	4
+#endif
+
+#if defined(XPAR_MICROBLAZE_DCACHE_USE_WRITEBACK) && \
+	(XPAR_MICROBLAZE_DCACHE_USE_WRITEBACK != 0)
+# define DCACHE_WRITEBACK
+#endif
+
+#define LINE_DOWN(addr, line)	((addr) & ~((ulong)(line) - 1))
+#define LINE_UP(addr, line)	LINE_DOWN((addr) + (line) - 1, line)
+
+#ifdef CONFIG_DCACHE
+/*
+ * With a write-back cache wdc.flush writes a dirty line back before
+ * dropping it and wdc.clear drops it without writing back.  With a
+ * write-through cache memory is never stale, so a plain wdc does for
+ * both.
+ */
+#ifdef DCACHE_WRITEBACK
+# define WDC_FLUSH(a)	asm volatile ("wdc.flush %0, r0;" : : "r" (a) : "memory")
+# define WDC_CLEAR(a)	asm volatile ("wdc.clear %0, r0;" : : "r" (a) : "memory")
+#else
+# define WDC_FLUSH(a)	asm volatile ("wdc %0, r0;" : : "r" (a) : "memory")
+# define WDC_CLEAR(a)	WDC_FLUSH(a)
+#endif
+
+/* Write back and drop every line, addressing the cache by index */
+static void __flush_dcache_all (void)
+{
+	ulong i;
+
+	for (i = 0; i < DCACHE_SIZE; i += DCACHE_LINE)
+		WDC_FLUSH(i);
+}
+#endif
+
+#ifdef CONFIG_ICACHE
+# define WIC(a)		asm volatile ("wic %0, r0;" : : "r" (a) : "memory")
+
+static void __invalidate_icache_all (void)
+{
+	ulong i;
+
+	for (i = 0; i < ICACHE_SIZE; i += ICACHE_LINE)
+		WIC(i);
+}
+#endif
+
+/*
+ * Write back any dirty lines covering [start, stop), e.g. before a DMA
+ * master reads the memory.  A write-through cache never holds dirty
+ * lines, so there is nothing to do.
+ */
+void flush_dcache_range (ulong start, ulong stop)
+{
+#if defined(CONFIG_DCACHE) && defined(DCACHE_WRITEBACK)
+	ulong addr;
+
+	if (stop - start >= DCACHE_SIZE) {
+		__flush_dcache_all();
+		return;
+	}
+
+	for (addr = LINE_DOWN(start, DCACHE_LINE); addr < stop;
+	     addr += DCACHE_LINE)
+		WDC_FLUSH(addr);
+#endif
+}
+
+/*
+ * Drop the lines covering [start, stop), e.g. after a DMA master wrote
+ * the memory.  Lines only partly inside the range also hold data that
+ * is not ours, so those are written back rather than discarded.
+ */
+void invalidate_dcache_range (ulong start, ulong stop)
+{
+#ifdef CONFIG_DCACHE
+	ulong first = LINE_DOWN(start, DCACHE_LINE);
+	ulong last = LINE_UP(stop, DCACHE_LINE);
+	ulong addr;
+
+	if (stop <= start)
+		return;
+
+	if (last - first >= DCACHE_SIZE) {
+		__flush_dcache_all();
+		return;
+	}
+
+	if (first != start) {
+		WDC_FLUSH(first);
+		first += DCACHE_LINE;
+	}
+	if ((last != stop) && (last > first)) {
+		last -= DCACHE_LINE;
+		WDC_FLUSH(last);
+	}
+
+	for (addr = first; addr < last; addr += DCACHE_LINE)
+		WDC_CLEAR(addr);
+#endif
+}
+
 void	icache_enable (void) {
 	MSRSET(0x20);
 }
 
 void	icache_disable(void) {
-	/* we are not generate ICACHE size -> flush whole cache */
-	flush_cache(0, 32768);
+#ifdef CONFIG_ICACHE
+	__invalidate_icache_all();
+#endif
 	MSRCLR(0x20);
 }
 
@@ -60,31 +193,32 @@ void	dcache_enable (void) {
 }
 
 void	dcache_disable(void) {
-#ifdef XILINX_USE_DCACHE
-#ifdef XILINX_DCACHE_BYTE_SIZE
-	flush_cache(0, XILINX_DCACHE_BYTE_SIZE);
-#else
-#warning please rebuild BSPs and update configuration
-	flush_cache(0, 32768);
-#endif
+#ifdef CONFIG_DCACHE
+	__flush_dcache_all();
 #endif
 	MSRCLR(0x80);
 }
 
+/*
+ * Make [addr, addr + size) coherent for execution: write back the data
+ * cache and drop stale instructions.
+ */
 void flush_cache (ulong addr, ulong size)
 {
-	int i;
-	for (i = 0; i < size; i += 4)
-		asm volatile (
 #ifdef CONFIG_ICACHE
-				"wic	%0, r0;"
+	ulong i;
 #endif
-				"nop;"
-#ifdef CONFIG_DCACHE
-				"wdc.flush	%0, r0;"
+
+	flush_dcache_range(addr, addr + size);
+
+#ifdef CONFIG_ICACHE
+	if (size >= ICACHE_SIZE) {
+		__invalidate_icache_all();
+		return;
+	}
+
+	for (i = LINE_DOWN(addr, ICACHE_LINE); i < addr + size;
+	     i += ICACHE_LINE)
+		WIC(i);
 #endif
-				"nop;"
-				:
-				: "r" (addr + i)
-				: "memory");
 }
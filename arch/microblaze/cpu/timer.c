@@ -25,9 +25,100 @@
 #include <common.h>
 #include <asm/microblaze_timer.h>
 #include <asm/microblaze_intc.h>
+#include <asm/asm.h>
+#include <div64.h>
+#include <bootstage.h>
 
 volatile int timestamp = 0;
 
+#ifdef CONFIG_SYS_TIMER_0_TIMEBASE
+/*
+ * Timebase: the second counter of the XPS timer counts up freely at
+ * CONFIG_SYS_TIMER_0_FREQ and wraps every 2^32 ticks; the wraps are
+ * counted in software to give 64 bit ticks.  This works with interrupts
+ * off, as long as the ticks are read at least once per wrap (about a
+ * minute at 62.5 MHz) - the timer interrupt sees to that otherwise.
+ */
+#ifndef CONFIG_SYS_TIMER_0_FREQ
+# error "CONFIG_SYS_TIMER_0_TIMEBASE needs CONFIG_SYS_TIMER_0_FREQ"
+#endif
+
+static microblaze_timer_t *tb_tmr =
+	(microblaze_timer_t *) (CONFIG_SYS_TIMER_0_ADDR + TIMER_1_OFFSET);
+
+static ulong tb_last;		/* counter value at the last read */
+static ulong tb_wraps;		/* upper 32 bits of the tick count */
+static ulong tb_offset;		/* get_timer() value subtracted by set_timer() */
+
+static unsigned long long tb_update (void)
+{
+	ulong now = tb_tmr->counter;
+
+	if (now < tb_last)
+		tb_wraps++;
+	tb_last = now;
+
+	return ((unsigned long long)tb_wraps << 32) | now;
+}
+
+unsigned long long get_ticks (void)
+{
+	unsigned long long ticks;
+	ulong msr;
+
+	/* the timer interrupt updates the wrap count too */
+	MFS(msr, rmsr);
+	MSRCLR(0x2);
+	ticks = tb_update ();
+	if (msr & 0x2)
+		MSRSET(0x2);
+
+	return ticks;
+}
+
+ulong get_tbclk (void)
+{
+	return CONFIG_SYS_TIMER_0_FREQ;
+}
+
+#ifdef CONFIG_BOOTSTAGE
+ulong timer_get_boot_us (void)
+{
+	return (ulong)lldiv (get_ticks () * 1000,
+			     CONFIG_SYS_TIMER_0_FREQ / 1000);
+}
+#endif
+
+static ulong tb_get_ms (void)
+{
+	return (ulong)lldiv (get_ticks (), CONFIG_SYS_TIMER_0_FREQ / 1000);
+}
+
+void reset_timer (void)
+{
+	tb_offset = tb_get_ms ();
+}
+
+ulong get_timer (ulong base)
+{
+	return tb_get_ms () - tb_offset - base;
+}
+
+void set_timer (ulong t)
+{
+	tb_offset = tb_get_ms () - t;
+}
+
+static void tb_init (void)
+{
+	tb_tmr->loadreg = 0;
+	tb_tmr->control = TIMER_RESET;
+	tb_tmr->control = TIMER_ENABLE | TIMER_RELOAD;
+	tb_last = 0;
+	tb_wraps = 0;
+	tb_offset = 0;
+}
+#else
 void reset_timer (void)
 {
 	timestamp = 0;
@@ -49,6 +140,7 @@ void set_timer (ulong t)
 {
 	timestamp = t;
 }
+#endif /* CONFIG_SYS_TIMER_0_TIMEBASE */
 
 #ifdef CONFIG_SYS_INTC_0
 #ifdef CONFIG_SYS_TIMER_0
@@ -57,11 +149,26 @@ microblaze_timer_t *tmr = (microblaze_timer_t *) (CONFIG_SYS_TIMER_0_ADDR);
 void timer_isr (void *arg)
 {
 	timestamp++;
+#ifdef CONFIG_SYS_TIMER_0_TIMEBASE
+	tb_update ();
+#endif
+#ifdef CONFIG_CMD_PROFILE
+	{
+		ulong pc;
+
+		/* r14 holds the interrupted PC until the handler returns */
+		R14(pc);
+		profile_sample (pc);
+	}
+#endif
 	tmr->control = tmr->control | TIMER_INTERRUPT;
 }
 
 int timer_init (void)
 {
+#ifdef CONFIG_SYS_TIMER_0_TIMEBASE
+	tb_init ();
+#endif
 	tmr->loadreg = CONFIG_SYS_TIMER_0_PRELOAD;
 	tmr->control = TIMER_INTERRUPT | TIMER_RESET;
 	tmr->control =
@@ -34,6 +34,9 @@
 #define TIMER_DOWN_COUNT    0x002 /* UDT0 */
 #define TIMER_CAPTURE_MODE  0x001 /* MDT0 */
 
+/* The second counter of a dual timer (TCSR1) */
+#define TIMER_1_OFFSET      0x10
+
 typedef volatile struct microblaze_timer_t {
 	int control; /* control/statuc register TCSR */
 	int loadreg; /* load register TLR */
@@ -31,6 +31,7 @@
 #include <version.h>
 #include <watchdog.h>
 #include <stdio_dev.h>
+#include <bootstage.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -116,6 +117,7 @@ void board_init (void)
 			hang ();
 		}
 	}
+	bootstage_mark ("init_sequence");
 
 	puts ("SDRAM :\n");
 	printf ("\t\tIcache:%s\n", icache_status() ? "ON" : "OFF");
@@ -155,6 +157,7 @@ void board_init (void)
 
 	/* relocate environment function pointers etc. */
 	env_relocate ();
+	bootstage_mark ("env_relocate");
 
 	/* Initialize stdio devices */
 	stdio_init ();
@@ -168,6 +171,7 @@ void board_init (void)
 	puts ("Net:   ");
 #endif
 	eth_initialize (bd);
+	bootstage_mark ("eth_initialize");
 #endif
 
 #if 0 /* foo */
@@ -27,6 +27,7 @@
 #include <common.h>
 #include <command.h>
 #include <image.h>
+#include <bootstage.h>
 #include <u-boot/zlib.h>
 #include <asm/byteorder.h>
 
@@ -73,14 +74,20 @@ int do_bootm_linux(int flag, int argc, char *argv[], bootm_headers_t *images)
 		(ulong) theKernel, rd_data_start, (ulong) of_flat_tree);
 #endif
 
-#ifdef XILINX_USE_DCACHE
-#ifdef XILINX_DCACHE_BYTE_SIZE
-	flush_cache(0, XILINX_DCACHE_BYTE_SIZE);
-#else
-#warning please rebuild BSPs and update configuration
-	flush_cache(0, 32768);
-#endif
+	bootstage_mark ("start_kernel");
+#if defined(CONFIG_BOOTSTAGE) && defined(CONFIG_OF_LIBFDT) && \
+	defined(CONFIG_LMB)
+	/*
+	 * Make room in the blob for the bootstage records.  Without an FDT
+	 * found by boot_get_fdt() (of_size 0) nothing is padded; skip it.
+	 */
+	if (of_flat_tree && of_size && !boot_relocate_fdt (&images->lmb,
+				getenv_bootm_low (), &of_flat_tree, &of_size))
+		bootstage_fdt_add_report (of_flat_tree);
 #endif
+
+	/* whole data and instruction caches */
+	flush_cache(0, ~0UL);
 	/*
 	 * Linux Kernel Parameters (passing device tree):
 	 * r5: pointer to command line
@@ -0,0 +1,227 @@
+/*
+ * MicroBlaze memcpy/memmove/memset
+ *
+ * The generic versions in lib/string.c only move whole words when both
+ * pointers are already aligned, and go byte by byte otherwise - which is
+ * the normal case for network payloads sitting at a 2 byte offset.  These
+ * align the destination first, move aligned data 32 bytes per loop with
+ * all loads issued ahead of the stores, and, when the core has a barrel
+ * shifter, assemble words for a misaligned source by shifting and merging
+ * pairs of aligned loads.
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef USE_HOSTCC	/* tools/mb_string_test includes this file */
+#include <common.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#endif
+
+/*
+ * Without a barrel shifter a variable shift is a loop of single bit
+ * shifts, which is slower than simply copying the bytes.
+ */
+#if defined(XPAR_MICROBLAZE_USE_BARREL) && (XPAR_MICROBLAZE_USE_BARREL != 0)
+# define MB_SHIFT_MERGE
+#endif
+
+/* Bytes of the lower address are in the most significant end on BE */
+#ifdef __MICROBLAZEEL__
+# define MERGE(w0, w1, lsh, rsh)	(((w0) >> (lsh)) | ((w1) << (rsh)))
+#else
+# define MERGE(w0, w1, lsh, rsh)	(((w0) << (lsh)) | ((w1) >> (rsh)))
+#endif
+
+/* Short copies are not worth the alignment work */
+#define MB_STRING_THRESHOLD	16
+
+static inline void copy_words_fwd(u32 *d, const u32 *s, size_t words)
+{
+	while (words >= 8) {
+		u32 a0 = s[0], a1 = s[1], a2 = s[2], a3 = s[3];
+		u32 a4 = s[4], a5 = s[5], a6 = s[6], a7 = s[7];
+
+		d[0] = a0; d[1] = a1; d[2] = a2; d[3] = a3;
+		d[4] = a4; d[5] = a5; d[6] = a6; d[7] = a7;
+		d += 8;
+		s += 8;
+		words -= 8;
+	}
+	while (words--)
+		*d++ = *s++;
+}
+
+static inline void copy_words_bwd(u32 *d, const u32 *s, size_t words)
+{
+	while (words >= 8) {
+		u32 a0, a1, a2, a3, a4, a5, a6, a7;
+
+		d -= 8;
+		s -= 8;
+		a7 = s[7]; a6 = s[6]; a5 = s[5]; a4 = s[4];
+		a3 = s[3]; a2 = s[2]; a1 = s[1]; a0 = s[0];
+		d[7] = a7; d[6] = a6; d[5] = a5; d[4] = a4;
+		d[3] = a3; d[2] = a2; d[1] = a1; d[0] = a0;
+		words -= 8;
+	}
+	while (words--)
+		*--d = *--s;
+}
+
+#ifdef MB_SHIFT_MERGE
+/*
+ * Copy words to an aligned destination from a source that is not word
+ * aligned.  Only the aligned words holding source bytes are read.
+ */
+static inline void copy_words_merge(u32 *d, const u8 *src, size_t words)
+{
+	unsigned int lsh = ((ulong)src & 3) * 8;
+	unsigned int rsh = 32 - lsh;
+	const u32 *s = (const u32 *)((ulong)src & ~3UL);
+	u32 w0 = *s++, w1;
+
+	while (words >= 4) {
+		u32 a0 = s[0], a1 = s[1], a2 = s[2], a3 = s[3];
+
+		d[0] = MERGE(w0, a0, lsh, rsh);
+		d[1] = MERGE(a0, a1, lsh, rsh);
+		d[2] = MERGE(a1, a2, lsh, rsh);
+		d[3] = MERGE(a2, a3, lsh, rsh);
+		w0 = a3;
+		d += 4;
+		s += 4;
+		words -= 4;
+	}
+	while (words--) {
+		w1 = *s++;
+		*d++ = MERGE(w0, w1, lsh, rsh);
+		w0 = w1;
+	}
+}
+#endif
+
+void *memcpy(void *dest, const void *src, size_t count)
+{
+	u8 *d = dest;
+	const u8 *s = src;
+	size_t words;
+
+	if (count >= MB_STRING_THRESHOLD) {
+		while ((ulong)d & 3) {
+			*d++ = *s++;
+			count--;
+		}
+
+		words = count >> 2;
+		if (((ulong)s & 3) == 0) {
+			copy_words_fwd((u32 *)d, (const u32 *)s, words);
+			d += words << 2;
+			s += words << 2;
+			count &= 3;
+		}
+#ifdef MB_SHIFT_MERGE
+		else {
+			copy_words_merge((u32 *)d, s, words);
+			d += words << 2;
+			s += words << 2;
+			count &= 3;
+		}
+#endif
+	}
+
+	while (count >= 4) {
+		d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+		d += 4;
+		s += 4;
+		count -= 4;
+	}
+	while (count--)
+		*d++ = *s++;
+
+	return dest;
+}
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+	u8 *d = dest;
+	const u8 *s = src;
+	size_t words;
+
+	/* Forward copies read ahead of where they write, so this is safe */
+	if (d <= s || d >= s + count)
+		return memcpy(dest, src, count);
+
+	d += count;
+	s += count;
+
+	if (count >= MB_STRING_THRESHOLD && (((ulong)d ^ (ulong)s) & 3) == 0) {
+		while ((ulong)d & 3) {
+			*--d = *--s;
+			count--;
+		}
+
+		words = count >> 2;
+		copy_words_bwd((u32 *)d, (const u32 *)s, words);
+		d -= words << 2;
+		s -= words << 2;
+		count &= 3;
+	}
+
+	while (count--)
+		*--d = *--s;
+
+	return dest;
+}
+
+void *memset(void *s, int c, size_t count)
+{
+	u8 *d = s;
+	u32 *dl;
+	u32 cl;
+
+	if (count >= MB_STRING_THRESHOLD) {
+		while ((ulong)d & 3) {
+			*d++ = c;
+			count--;
+		}
+
+		cl = c & 0xff;
+		cl |= cl << 8;
+		cl |= cl << 16;
+
+		dl = (u32 *)d;
+		while (count >= 32) {
+			dl[0] = cl; dl[1] = cl; dl[2] = cl; dl[3] = cl;
+			dl[4] = cl; dl[5] = cl; dl[6] = cl; dl[7] = cl;
+			dl += 8;
+			count -= 32;
+		}
+		while (count >= 4) {
+			*dl++ = cl;
+			count -= 4;
+		}
+		d = (u8 *)dl;
+	}
+
+	while (count--)
+		*d++ = c;
+
+	return s;
+}
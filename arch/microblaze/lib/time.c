@@ -25,8 +25,20 @@
  */
 
 #include <common.h>
+#include <div64.h>
 
-#ifdef CONFIG_SYS_TIMER_0
+#if defined(CONFIG_SYS_TIMER_0_TIMEBASE)
+void __udelay (unsigned long usec)
+{
+	unsigned long long start = get_ticks ();
+	unsigned long long ticks;
+
+	ticks = lldiv ((unsigned long long)usec * CONFIG_SYS_TIMER_0_FREQ,
+		       1000000);
+	while (get_ticks () - start < ticks)
+		;
+}
+#elif defined(CONFIG_SYS_TIMER_0)
 void __udelay (unsigned long usec)
 {
 	int i;
@@ -49,6 +49,7 @@ typedef struct {
   uint32_t             bytesReceived;
   uint8_t             *fwImageBase;
   uint8_t             *fwImagePtr;
+  uint32_t             dataCrc;
   string_t             cmd;
 } FirmwareUpdateCtxt_t;
 
@@ -90,10 +91,42 @@ AvbDefs__ErrorCode startFirmwareUpdate(string_t cmd,
   fwUpdateCtxt.bytesReceived         = 0;
   fwUpdateCtxt.fwImageBase           = (uint8_t*) XPAR_DDR2_CONTROL_MPMC_BASEADDR;
   fwUpdateCtxt.fwImagePtr            = fwUpdateCtxt.fwImageBase;
+  fwUpdateCtxt.dataCrc               = 0;
   
   return(returnValue);
 }
 
+/**
+ * Copy a data packet into the image buffer, computing the CRC of the
+ * image data on the way in so it need not be read back once the whole
+ * image has arrived.  The legacy image header is copied first, since the
+ * extent of the data it covers isn't known until the header is complete.
+ */
+static void copyDataPacket(const uint8_t *src, uint32_t size)
+{
+  uint8_t *dst = fwUpdateCtxt.fwImagePtr;
+  uint32_t offset = fwUpdateCtxt.bytesReceived;
+  uint32_t hdrSize = image_get_header_size();
+  uint32_t dataEnd;
+  uint32_t chunk;
+
+  if(offset < hdrSize) {
+    chunk = min(size, (hdrSize - offset));
+    memcpy(dst, src, chunk);
+    dst    += chunk;
+    src    += chunk;
+    size   -= chunk;
+    offset += chunk;
+  }
+
+  if(size > 0) {
+    dataEnd = (hdrSize + image_get_data_size((image_header_t *)fwUpdateCtxt.fwImageBase));
+    chunk = ((offset < dataEnd) ? min(size, (dataEnd - offset)) : 0);
+    fwUpdateCtxt.dataCrc = memcpy_crc32(fwUpdateCtxt.dataCrc, dst, src, chunk);
+    memcpy((dst + chunk), (src + chunk), (size - chunk));
+  }
+}
+
 /**
  * Accept a Data packet for a firmware update. Must be called while we are in the process 
  * of a firmware update (i.e. startFirmwareUpdate() called first. 
@@ -105,7 +138,7 @@ AvbDefs__ErrorCode sendDataPacket(FirmwareUpdate__FwData *data)
   AvbDefs__ErrorCode returnValue = e_EC_SUCCESS;
 
   if(!fwUpdateCtxt.bUpdateInProgress) return e_EC_UPDATE_NOT_IN_PROGRESS;
-  memcpy(fwUpdateCtxt.fwImagePtr,data->m_data,data->m_size);
+  copyDataPacket(data->m_data, data->m_size);
   fwUpdateCtxt.bytesReceived+=data->m_size;
 
 #ifdef _LABXDEBUG
@@ -131,12 +164,21 @@ AvbDefs__ErrorCode sendDataPacket(FirmwareUpdate__FwData *data)
 }
 
 int doCrcCheck(void) {
+  image_header_t *hdr = (image_header_t *)fwUpdateCtxt.fwImageBase;
   int returnValue = 0;
+  int crcGood;
 
-  if(image_check_type((image_header_t *)fwUpdateCtxt.fwImageBase, IH_TYPE_KERNEL)) {
+  if(image_check_type(hdr, IH_TYPE_KERNEL)) {
     printf("   Verifying Checksum ... ");
     setenv("crcreturn", "0");
-    if (!image_check_dcrc ((image_header_t *)fwUpdateCtxt.fwImageBase)) {
+
+    /* Use the CRC accumulated by copyDataPacket() if all the data arrived */
+    if(fwUpdateCtxt.bytesReceived >= image_get_image_size(hdr)) {
+      printf("(checksum = 0x%08X) ", fwUpdateCtxt.dataCrc);
+      crcGood = (fwUpdateCtxt.dataCrc == image_get_dcrc(hdr));
+    } else crcGood = image_check_dcrc(hdr);
+
+    if (!crcGood) {
       printf("Bad Data CRC - please retry\n");
       setenv("crcreturn", "1");
       goto end;
@@ -0,0 +1,150 @@
+/*
+ * Boot stage timestamps
+ *
+ * A fixed table of named timestamps, filled in by bootstage_mark() from
+ * the start of board_init() up to the jump into the OS.  Nothing here
+ * allocates memory, so marks can be taken before malloc is available.
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <command.h>
+#include <bootstage.h>
+#ifdef CONFIG_OF_LIBFDT
+#include <libfdt.h>
+#endif
+
+#ifndef CONFIG_BOOTSTAGE_RECORD_COUNT
+#define CONFIG_BOOTSTAGE_RECORD_COUNT	32
+#endif
+
+struct bootstage_record {
+	ulong		time_us;
+	const char	*name;
+};
+
+static struct bootstage_record record[CONFIG_BOOTSTAGE_RECORD_COUNT];
+static int record_count;
+static int record_dropped;
+
+/*
+ * Default boot time source, in milliseconds resolution.  Architectures
+ * with a proper timebase provide their own.
+ */
+ulong __timer_get_boot_us (void)
+{
+	return get_timer (0) * 1000;
+}
+ulong timer_get_boot_us (void)
+	__attribute__((weak, alias("__timer_get_boot_us")));
+
+ulong bootstage_mark (const char *name)
+{
+	ulong now = timer_get_boot_us ();
+
+	if (record_count < CONFIG_BOOTSTAGE_RECORD_COUNT) {
+		record[record_count].time_us = now;
+		record[record_count].name = name;
+		record_count++;
+	} else {
+		record_dropped++;
+	}
+
+	return now;
+}
+
+void bootstage_report (void)
+{
+	ulong prev = 0;
+	int i;
+
+	puts ("Timer summary in microseconds:\n");
+	printf ("%11s%11s  %s\n", "Mark", "Elapsed", "Stage");
+	for (i = 0; i < record_count; i++) {
+		printf ("%11lu%11lu  %s\n", record[i].time_us,
+			record[i].time_us - prev, record[i].name);
+		prev = record[i].time_us;
+	}
+	if (record_dropped)
+		printf ("(%d marks dropped, increase "
+			"CONFIG_BOOTSTAGE_RECORD_COUNT)\n", record_dropped);
+}
+
+#ifdef CONFIG_OF_LIBFDT
+/*
+ * Export the records as
+ *
+ *	/chosen/bootstage/<n> { name = "<stage>"; mark = <usec>; };
+ *
+ * so the OS can collect them after boot.
+ */
+int bootstage_fdt_add_report (void *blob)
+{
+	char num[12];
+	int chosen, parent, node, i;
+
+	chosen = fdt_path_offset (blob, "/chosen");
+	if (chosen < 0)
+		chosen = fdt_add_subnode (blob, 0, "chosen");
+	if (chosen < 0)
+		goto error;
+
+	parent = fdt_subnode_offset (blob, chosen, "bootstage");
+	if (parent >= 0)
+		fdt_del_node (blob, parent);
+	parent = fdt_add_subnode (blob, chosen, "bootstage");
+	if (parent < 0)
+		goto error;
+
+	for (i = 0; i < record_count; i++) {
+		sprintf (num, "%d", i);
+		node = fdt_add_subnode (blob, parent, num);
+		if ((node < 0) ||
+		    (fdt_setprop_string (blob, node, "name", record[i].name) < 0) ||
+		    (fdt_setprop_cell (blob, node, "mark", record[i].time_us) < 0))
+			goto error;
+	}
+
+	return 0;
+
+error:
+	puts ("WARNING: could not add bootstage records to the device tree\n");
+	return -1;
+}
+#endif
+
+#ifdef CONFIG_CMD_BOOTSTAGE
+int do_bootstage (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	if ((argc == 2) && (strcmp (argv[1], "report") == 0)) {
+		bootstage_report ();
+		return 0;
+	}
+
+	cmd_usage (cmdtp);
+	return 1;
+}
+
+U_BOOT_CMD(
+	bootstage,	2,	0,	do_bootstage,
+	"boot stage timing",
+	"report - print the boot stage timestamps"
+);
+#endif
@@ -28,6 +28,7 @@
 #include <common.h>
 #include <watchdog.h>
 #include <command.h>
+#include <bootstage.h>
 #include <image.h>
 #include <malloc.h>
 #include <u-boot/zlib.h>
@@ -61,6 +62,16 @@
 #include <linux/lzo.h>
 #endif /* CONFIG_LZO */
 
+#ifdef CONFIG_ZSOURCE
+#include <zsource.h>
+#endif
+
+/* "bootm sf:<offset>[#<conf>]" streams the kernel out of SPI flash */
+#if defined(CONFIG_ZSOURCE) && defined(CONFIG_SPI_FLASH)
+#define BOOTM_SF
+#include <spi_flash.h>
+#endif
+
 DECLARE_GLOBAL_DATA_PTR;
 
 #ifndef CONFIG_SYS_BOOTM_LEN
@@ -85,10 +96,15 @@ static int do_imls (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]);
 static void fixup_silent_linux (void);
 #endif
 
-static image_header_t *image_get_kernel (ulong img_addr, int verify);
+static image_header_t *image_get_kernel (ulong img_addr, int verify,
+					  int *dcrc_on_load);
 #if defined(CONFIG_FIT)
 static int fit_check_kernel (const void *fit, int os_noffset, int verify);
 #endif
+#ifdef BOOTM_SF
+static void *boot_get_kernel_sf (cmd_tbl_t *cmdtp, int argc, const char *arg,
+		bootm_headers_t *images, ulong *os_data, ulong *os_len);
+#endif
 
 static void *boot_get_kernel (cmd_tbl_t *cmdtp, int flag,int argc, char *argv[],
 		bootm_headers_t *images, ulong *os_data, ulong *os_len);
@@ -213,6 +229,8 @@ static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	void		*os_hdr;
 	int		ret;
 
+	bootstage_mark ("bootm_start");
+
 	memset ((void *)&images, 0, sizeof (images));
 	images.verify = getenv_yesno ("verify");
 
@@ -225,6 +243,7 @@ static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 		puts ("ERROR: can't get kernel image!\n");
 		return 1;
 	}
+	bootstage_mark ("kernel_checked");
 
 	/* get image parameters */
 	switch (genimg_get_format (os_hdr)) {
@@ -326,6 +345,129 @@ static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 #define BOOTM_ERR_RESET		-1
 #define BOOTM_ERR_OVERLAP	-2
 #define BOOTM_ERR_UNIMPLEMENTED	-3
+#define BOOTM_ERR_DCRC		-4
+
+#ifdef CONFIG_ZSOURCE
+/*
+ * Decompress (or copy) the os data from images.os_src to the load address
+ * as it is read, checking the data CRC of the compressed stream on the way
+ * if verify is set.
+ */
+static int bootm_load_os_stream(image_info_t os, ulong *load_end,
+				int boot_progress)
+{
+	struct zsource *src = images.os_src;
+	const char *type_name = genimg_get_type_name (os.type);
+	ulong unc_len = CONFIG_SYS_BOOTM_LEN;
+	int ret;
+
+	switch (os.comp) {
+	case IH_COMP_NONE:
+		printf ("   Loading %s from %s ... ", type_name, src->name);
+		ret = zsource_read (src, (void *)os.load, os.image_len);
+		unc_len = os.image_len;
+		break;
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		printf ("   Uncompressing %s from %s ... ", type_name, src->name);
+		ret = gunzip_stream ((void *)os.load, unc_len, src, &unc_len);
+		break;
+#endif /* CONFIG_GZIP */
+#ifdef CONFIG_LZMA
+	case IH_COMP_LZMA: {
+		SizeT lzma_len = unc_len;
+
+		printf ("   Uncompressing %s from %s ... ", type_name, src->name);
+		ret = lzmaStreamDecompress ((unsigned char *)os.load,
+				&lzma_len, src);
+		unc_len = lzma_len;
+		break;
+	}
+#endif /* CONFIG_LZMA */
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO: {
+		size_t lzo_len = unc_len;
+
+		printf ("   Uncompressing %s from %s ... ", type_name, src->name);
+		ret = lzop_decompress_stream (src, (unsigned char *)os.load,
+				&lzo_len);
+		unc_len = lzo_len;
+		break;
+	}
+#endif /* CONFIG_LZO */
+	default:
+		printf ("Compression type %d can't be streamed\n", os.comp);
+		zsource_end (src);
+		return BOOTM_ERR_UNIMPLEMENTED;
+	}
+
+	if (ret != 0) {
+		printf ("read, uncompress or overwrite error %d "
+			"- must RESET board to recover\n", ret);
+		if (boot_progress)
+			show_boot_progress (-6);
+		zsource_end (src);
+		return BOOTM_ERR_RESET;
+	}
+
+	/* the checks cover the whole stream, not just what was used */
+	if ((src->crc_on || src->digest) && zsource_finish (src) != 0) {
+		puts ("read error\n");
+		zsource_end (src);
+		return BOOTM_ERR_DCRC;
+	}
+
+	if (src->crc_on &&
+	    src->crc != image_get_dcrc (&images.legacy_hdr_os_copy)) {
+		puts ("Bad Data CRC\n");
+		if (boot_progress)
+			show_boot_progress (-3);
+		zsource_end (src);
+		return BOOTM_ERR_DCRC;
+	}
+#if defined(CONFIG_FIT)
+	if (src->digest) {
+		puts ("OK\n   Verifying Hash Integrity ... ");
+		if (!fit_image_hash_stream_check (images.fit_hdr_os,
+				images.fit_noffset_os, src->digest_priv)) {
+			puts ("Bad Data Hash\n");
+			if (boot_progress)
+				show_boot_progress (-104);
+			zsource_end (src);
+			return BOOTM_ERR_DCRC;
+		}
+	}
+#endif
+	zsource_end (src);
+
+	*load_end = os.load + unc_len;
+	return 0;
+}
+#endif /* CONFIG_ZSOURCE */
+
+/*
+ * Check whether [load, load_end) overlaps the os image in RAM.  Of an
+ * image read from flash only what was read is in RAM: nothing of a
+ * streamed legacy image, the blob and the ramdisk and FDT data of a FIT.
+ * The rest is still in flash and can't be overwritten.
+ */
+static int bootm_os_overlap(ulong load, ulong load_end,
+			    ulong blob_start, ulong blob_end)
+{
+	int i;
+
+	if (!images.os_src && !images.os_ram_cnt)
+		return (load < blob_end) && (load_end > blob_start);
+
+	for (i = 0; i < images.os_ram_cnt; i++) {
+		if ((load < images.os_ram_end[i]) &&
+		    (load_end > images.os_ram_start[i]))
+			return 1;
+	}
+
+	return 0;
+}
+
 static int bootm_load_os(image_info_t os, ulong *load_end, int boot_progress)
 {
 	uint8_t comp = os.comp;
@@ -338,6 +480,14 @@ static int bootm_load_os(image_info_t os, ulong *load_end, int boot_progress)
 
 	const char *type_name = genimg_get_type_name (os.type);
 
+#ifdef CONFIG_ZSOURCE
+	if (images.os_src) {
+		int err = bootm_load_os_stream (os, load_end, boot_progress);
+
+		if (err)
+			return err;
+	} else
+#endif
 	switch (comp) {
 	case IH_COMP_NONE:
 		if (load == blob_start) {
@@ -345,7 +495,19 @@ static int bootm_load_os(image_info_t os, ulong *load_end, int boot_progress)
 		} else {
 			printf ("   Loading %s ... ", type_name);
 
-			if (load != image_start) {
+			if (images.dcrc_on_load) {
+				/* checksum deferred by image_get_kernel() */
+				uint32_t dcrc = memcpy_crc32_wd (0, (void *)load,
+						(void *)image_start, image_len,
+						CHUNKSZ_CRC32);
+
+				if (dcrc != image_get_dcrc (&images.legacy_hdr_os_copy)) {
+					puts ("Bad Data CRC\n");
+					if (boot_progress)
+						show_boot_progress (-3);
+					return BOOTM_ERR_DCRC;
+				}
+			} else if (load != image_start) {
 				memmove_wd ((void *)load,
 						(void *)image_start, image_len, CHUNKSZ);
 			}
@@ -429,11 +591,12 @@ static int bootm_load_os(image_info_t os, ulong *load_end, int boot_progress)
 		return BOOTM_ERR_UNIMPLEMENTED;
 	}
 	puts ("OK\n");
+	bootstage_mark ("kernel_loaded");
 	debug ("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, *load_end);
 	if (boot_progress)
 		show_boot_progress (7);
 
-	if ((load < blob_end) && (*load_end > blob_start)) {
+	if (bootm_os_overlap (load, *load_end, blob_start, blob_end)) {
 		debug ("images.os.start = 0x%lX, images.os.end = 0x%lx\n", blob_start, blob_end);
 		debug ("images.os.load = 0x%lx, load_end = 0x%lx\n", load, *load_end);
 
@@ -613,7 +776,11 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 		 *
 		 * Right now we assume the first arg should never be '-'
 		 */
-		if ((*endp != 0) && (*endp != ':') && (*endp != '#'))
+		if ((*endp != 0) && (*endp != ':') && (*endp != '#')
+#ifdef BOOTM_SF
+		    && (strncmp (argv[1], "sf:", 3) != 0)
+#endif
+		   )
 			return do_bootm_subcommand(cmdtp, flag, argc, argv);
 	}
 
@@ -672,6 +839,11 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 			show_boot_progress (-7);
 			return 1;
 		}
+		if (ret == BOOTM_ERR_DCRC) {
+			if (iflag)
+				enable_interrupts();
+			return 1;
+		}
 	}
 
 	lmb_reserve(&images.lmb, images.os.load, (load_end - images.os.load));
@@ -715,10 +887,45 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	return 1;
 }
 
+/**
+ * image_dcrc_on_load - check if the data CRC can be verified while loading
+ * @hdr: pointer to a legacy image header with a valid header CRC
+ *
+ * An uncompressed image that bootm_load_os() has to copy anyway can be
+ * checksummed by the copy itself, saving a full pass over the data. This
+ * needs the copy to run forwards, so the load address must not lie
+ * inside the data, and only single component images qualify since the
+ * data CRC covers the whole image data.
+ *
+ * returns:
+ *     1 if the CRC check can be left to bootm_load_os(), 0 otherwise
+ */
+static int image_dcrc_on_load (const image_header_t *hdr)
+{
+	ulong data = image_get_data (hdr);
+	ulong len = image_get_data_size (hdr);
+	ulong load = image_get_load (hdr);
+
+	if (image_get_comp (hdr) != IH_COMP_NONE)
+		return 0;
+	if ((image_get_type (hdr) != IH_TYPE_KERNEL) &&
+	    (image_get_type (hdr) != IH_TYPE_STANDALONE))
+		return 0;
+	/* XIP or already in place, nothing gets copied */
+	if ((load == (ulong)hdr) || (load == data))
+		return 0;
+	if ((load > data) && (load < data + len))
+		return 0;
+
+	return 1;
+}
+
 /**
  * image_get_kernel - verify legacy format kernel image
  * @img_addr: in RAM address of the legacy format image to be verified
  * @verify: data CRC verification flag
+ * @dcrc_on_load: pointer to an int, set if the data CRC check has been
+ *                left to bootm_load_os()
  *
  * image_get_kernel() verifies legacy image integrity and returns pointer to
  * legacy image header if image verification was completed successfully.
@@ -727,7 +934,8 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
  *     pointer to a legacy image header if valid image was found
  *     otherwise return NULL
  */
-static image_header_t *image_get_kernel (ulong img_addr, int verify)
+static image_header_t *image_get_kernel (ulong img_addr, int verify,
+					  int *dcrc_on_load)
 {
 	image_header_t *hdr = (image_header_t *)img_addr;
 
@@ -747,7 +955,10 @@ static image_header_t *image_get_kernel (ulong img_addr, int verify)
 	show_boot_progress (3);
 	image_print_contents (hdr);
 
-	if (verify) {
+	*dcrc_on_load = verify && image_dcrc_on_load (hdr);
+	if (*dcrc_on_load) {
+		puts ("   Verifying Checksum ... while loading\n");
+	} else if (verify) {
 		puts ("   Verifying Checksum ... ");
 		if (!image_check_dcrc (hdr)) {
 			printf ("Bad Data CRC\n");
@@ -813,6 +1024,354 @@ static int fit_check_kernel (const void *fit, int os_noffset, int verify)
 }
 #endif /* CONFIG_FIT */
 
+#ifdef BOOTM_SF
+#ifndef CONFIG_SF_DEFAULT_BUS
+# define CONFIG_SF_DEFAULT_BUS		0
+#endif
+#ifndef CONFIG_SF_DEFAULT_CS
+# define CONFIG_SF_DEFAULT_CS		0
+#endif
+#ifndef CONFIG_SF_DEFAULT_SPEED
+# define CONFIG_SF_DEFAULT_SPEED	1000000
+#endif
+#ifndef CONFIG_SF_DEFAULT_MODE
+# define CONFIG_SF_DEFAULT_MODE		SPI_MODE_3
+#endif
+
+static struct zsource sf_src;
+
+#if defined(CONFIG_FIT)
+static struct fit_hash_stream sf_fit_hash;
+
+static void sf_fit_digest (struct zsource *src, const void *data, size_t len)
+{
+	fit_image_hash_stream_update (src->digest_priv, data, len);
+}
+
+/* Note a part of the image that has been read to RAM */
+static void sf_note_ram (bootm_headers_t *images, ulong start, ulong len)
+{
+	int n = images->os_ram_cnt++;
+
+	images->os_ram_start[n] = start;
+	images->os_ram_end[n] = start + len;
+}
+
+/*
+ * The offsets and sizes of a FIT in flash come from the image itself, so
+ * check them before reading: len bytes at rel past flash offset offset must
+ * be in the flash and, unless ram is NULL, fit at rel past ram in the RAM
+ * bootm may use (bootm_low/bootm_size) below U-Boot's stack, which is below
+ * its malloc area and code.
+ */
+static int sf_check_read (struct spi_flash *flash, ulong offset, ulong rel,
+		ulong len, void *ram)
+{
+	ulong	low = getenv_bootm_low ();
+	ulong	high = low + getenv_bootm_size ();
+	ulong	sp = (ulong)&low;
+
+	if (offset > flash->size || rel > flash->size - offset ||
+	    len > flash->size - offset - rel) {
+		printf ("Image data at %08lx (%lu bytes) is beyond the end "
+			"of the flash\n", offset + rel, len);
+		return -1;
+	}
+	if (!ram)
+		return 0;
+
+	/* leave the stack some room to grow */
+	if (high > sp - 4096)
+		high = sp - 4096;
+	if ((ulong)ram < low || (ulong)ram > high ||
+	    rel > high - (ulong)ram || len > high - (ulong)ram - rel) {
+		printf ("Image data for %08lx (%lu bytes) does not fit in RAM "
+			"below U-Boot\n", (ulong)ram + rel, len);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Read the external data of a FIT component image from flash to its place
+ * after the blob at fit, where it would be had the whole FIT been read.
+ */
+static int fit_sf_read_image (struct spi_flash *flash, ulong offset,
+		void *fit, int noffset, bootm_headers_t *images)
+{
+	ulong	ext, base;
+	size_t	size;
+
+	/* not in this configuration, or stored in the blob */
+	if (noffset < 0 || fit_image_get_data_ext (fit, noffset, &ext, &size))
+		return 0;
+
+	base = fit_get_ext_base (fit);
+	if (sf_check_read (flash, offset + base, ext, size, (char *)fit + base))
+		return -1;
+
+	ext += base;
+	printf ("   Reading '%s' data from %08lx (%u bytes)\n",
+			fit_get_name (fit, noffset, NULL), offset + ext,
+			(uint)size);
+
+	if (spi_flash_read (flash, offset + ext, size, (char *)fit + ext))
+		return -1;
+	sf_note_ram (images, (ulong)fit + ext, size);
+
+	return 0;
+}
+
+/**
+ * boot_get_fit_sf - find a kernel in a FIT image in SPI flash
+ * @flash: flash holding the image, freed here on failure
+ * @offset: flash offset of the image
+ * @fit_uname_config: configuration to use, or NULL for the default one
+ *
+ * Only the FIT blob is read, to load_addr.  When the images keep their
+ * data after the blob (mkimage -E), just the ramdisk and FDT of the chosen
+ * configuration are read from there, to the addresses they would have if
+ * the whole FIT had been read, and are checked in RAM by boot_get_ramdisk()
+ * and boot_get_fdt() as usual.  The kernel data is left for bootm_load_os()
+ * to stream to its load address, computing its hashes as it is read.
+ *
+ * returns:
+ *     pointer to the FIT blob if a valid kernel image was found,
+ *     otherwise NULL
+ */
+static void *boot_get_fit_sf (cmd_tbl_t *cmdtp, int argc,
+		struct spi_flash *flash, ulong offset,
+		const char *fit_uname_config, bootm_headers_t *images,
+		ulong *os_data, ulong *os_len)
+{
+	void		*fit_hdr = (void *)load_addr;
+	const char	*fit_uname_kernel;
+	const void	*data;
+	size_t		len;
+	ulong		ext;
+	int		cfg_noffset;
+	int		os_noffset;
+	int		rd_noffset;
+	int		fdt_noffset;
+
+	printf ("## Booting kernel from FIT Image in SPI flash at %08lx ...\n",
+			offset);
+
+	len = fdt_totalsize (&images->legacy_hdr_os_copy);
+	if (len < sizeof (image_header_t) ||
+	    sf_check_read (flash, offset, 0, len, fit_hdr) ||
+	    spi_flash_read (flash, offset, len, fit_hdr)) {
+		puts ("Can't read FIT image\n");
+		goto err;
+	}
+	sf_note_ram (images, (ulong)fit_hdr, len);
+
+	if (!fit_check_format (fit_hdr)) {
+		puts ("Bad FIT kernel image format!\n");
+		show_boot_progress (-100);
+		goto err;
+	}
+	show_boot_progress (100);
+
+	cfg_noffset = fit_conf_get_node (fit_hdr, fit_uname_config);
+	if (cfg_noffset < 0) {
+		show_boot_progress (-101);
+		goto err;
+	}
+	images->fit_uname_cfg = fdt_get_name (fit_hdr, cfg_noffset, NULL);
+	printf ("   Using '%s' configuration\n", images->fit_uname_cfg);
+	show_boot_progress (103);
+
+	os_noffset = fit_conf_get_kernel_node (fit_hdr, cfg_noffset);
+	if (os_noffset < 0) {
+		show_boot_progress (-103);
+		goto err;
+	}
+	fit_uname_kernel = fit_get_name (fit_hdr, os_noffset, NULL);
+	printf ("   Trying '%s' kernel subimage\n", fit_uname_kernel);
+	show_boot_progress (104);
+
+	/* bootm arguments given for the ramdisk or FDT override the config */
+	rd_noffset = (argc < 3) ?
+		fit_conf_get_ramdisk_node (fit_hdr, cfg_noffset) : -1;
+	fdt_noffset = (argc < 4) ?
+		fit_conf_get_fdt_node (fit_hdr, cfg_noffset) : -1;
+	if (fit_sf_read_image (flash, offset, fit_hdr, rd_noffset, images) ||
+	    fit_sf_read_image (flash, offset, fit_hdr, fdt_noffset, images)) {
+		puts ("Can't read FIT image data\n");
+		goto err;
+	}
+
+	if (fit_image_get_data_ext (fit_hdr, os_noffset, &ext, &len)) {
+		/* kernel data is in the blob, so it has been read already */
+		if (!fit_check_kernel (fit_hdr, os_noffset, images->verify))
+			goto err;
+
+		if (fit_image_get_data (fit_hdr, os_noffset, &data, &len)) {
+			puts ("Could not find kernel subimage data!\n");
+			show_boot_progress (-107);
+			goto err;
+		}
+		*os_data = (ulong)data;
+		*os_len = len;
+		spi_flash_free (flash);
+	} else {
+		if (!fit_check_kernel (fit_hdr, os_noffset, 0))
+			goto err;
+
+		if (sf_check_read (flash, offset + fit_get_ext_base (fit_hdr),
+				   ext, len, NULL))
+			goto err;
+
+		*os_data = offset + fit_get_ext_base (fit_hdr) + ext;
+		*os_len = len;
+		if (spi_flash_zsource (flash, *os_data, len, &sf_src)) {
+			puts ("Can't stream image data\n");
+			*os_data = *os_len = 0;
+			goto err;
+		}
+
+		if (images->verify) {
+			if (fit_image_hash_stream_start (fit_hdr, os_noffset,
+							 &sf_fit_hash)) {
+				puts ("Can't check kernel hashes\n");
+				zsource_end (&sf_src);
+				*os_data = *os_len = 0;
+				return NULL;
+			}
+			sf_src.digest = sf_fit_digest;
+			sf_src.digest_priv = &sf_fit_hash;
+			puts ("   Verifying Hash Integrity ... while loading\n");
+		}
+		images->os_src = &sf_src;
+	}
+	show_boot_progress (108);
+
+	images->fit_hdr_os = fit_hdr;
+	images->fit_uname_os = fit_uname_kernel;
+	images->fit_noffset_os = os_noffset;
+
+	return fit_hdr;
+
+err:
+	spi_flash_free (flash);
+	return NULL;
+}
+#endif /* CONFIG_FIT */
+
+/**
+ * boot_get_kernel_sf - find a kernel image in SPI flash
+ * @arg: the part of argv[1] after "sf:", the flash offset of the image,
+ *       followed by #<conf_uname> to pick a FIT configuration
+ * @os_data: pointer to a ulong variable, will hold os data flash offset
+ *           (or address, for a FIT with the kernel data in the blob)
+ * @os_len: pointer to a ulong variable, will hold os data length
+ *
+ * For a legacy image only the header is read here.  The data stays in
+ * flash until bootm_load_os() streams it to the load address through
+ * images->os_src, checking the data CRC on the way if verify is set.
+ * FIT images are handled by boot_get_fit_sf().
+ *
+ * returns:
+ *     pointer to the image header (or FIT blob) in RAM if a valid kernel
+ *     image was found, otherwise NULL
+ */
+static void *boot_get_kernel_sf (cmd_tbl_t *cmdtp, int argc, const char *arg,
+		bootm_headers_t *images, ulong *os_data, ulong *os_len)
+{
+	image_header_t	*hdr = &images->legacy_hdr_os_copy;
+	struct spi_flash *flash;
+	ulong		offset;
+	char		*end;
+
+	*os_data = *os_len = 0;
+	offset = simple_strtoul (arg, &end, 16);
+
+	/* an earlier bootm may have stopped before loading its image */
+	if (sf_src.buf)
+		zsource_end (&sf_src);
+
+	flash = spi_flash_probe (CONFIG_SF_DEFAULT_BUS, CONFIG_SF_DEFAULT_CS,
+			CONFIG_SF_DEFAULT_SPEED, CONFIG_SF_DEFAULT_MODE);
+	if (!flash) {
+		puts ("Failed to initialize SPI flash\n");
+		return NULL;
+	}
+	show_boot_progress (1);
+
+	/* big enough for the start of a FIT blob as well */
+	if (spi_flash_read (flash, offset, sizeof (image_header_t), hdr)) {
+		puts ("Can't read image header\n");
+		goto err;
+	}
+
+	switch (genimg_get_format (hdr)) {
+	case IMAGE_FORMAT_LEGACY:
+		break;
+#if defined(CONFIG_FIT)
+	case IMAGE_FORMAT_FIT:
+		return boot_get_fit_sf (cmdtp, argc, flash, offset,
+				(*end == '#') ? end + 1 : NULL,
+				images, os_data, os_len);
+#endif
+	default:
+		puts ("Bad Magic Number\n");
+		show_boot_progress (-1);
+		goto err;
+	}
+
+	printf ("## Booting kernel from Legacy Image in SPI flash at %08lx ...\n",
+			offset);
+	show_boot_progress (2);
+
+	if (!image_check_hcrc (hdr)) {
+		puts ("Bad Header Checksum\n");
+		show_boot_progress (-2);
+		goto err;
+	}
+	show_boot_progress (3);
+	image_print_contents (hdr);
+
+	if (image_get_type (hdr) != IH_TYPE_KERNEL) {
+		printf ("Wrong Image Type for %s command\n", cmdtp->name);
+		show_boot_progress (-5);
+		goto err;
+	}
+
+	if (!image_check_target_arch (hdr)) {
+		printf ("Unsupported Architecture 0x%x\n", image_get_arch (hdr));
+		show_boot_progress (-4);
+		goto err;
+	}
+
+	*os_data = offset + image_get_header_size ();
+	*os_len = image_get_data_size (hdr);
+
+	if (spi_flash_zsource (flash, *os_data, *os_len, &sf_src)) {
+		puts ("Can't stream image data\n");
+		*os_data = *os_len = 0;
+		goto err;
+	}
+
+	sf_src.crc_on = images->verify;
+	if (images->verify)
+		puts ("   Verifying Checksum ... while loading\n");
+	show_boot_progress (4);
+
+	images->os_src = &sf_src;
+	images->legacy_hdr_os = hdr;
+	images->legacy_hdr_valid = 1;
+	show_boot_progress (6);
+
+	return hdr;
+
+err:
+	spi_flash_free (flash);
+	return NULL;
+}
+#endif /* BOOTM_SF */
+
 /**
  * boot_get_kernel - find kernel image
  * @os_data: pointer to a ulong variable, will hold os data start address
@@ -840,6 +1399,12 @@ static void *boot_get_kernel (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]
 	int		os_noffset;
 #endif
 
+#ifdef BOOTM_SF
+	if (argc >= 2 && strncmp (argv[1], "sf:", 3) == 0)
+		return boot_get_kernel_sf (cmdtp, argc, argv[1] + 3, images,
+					   os_data, os_len);
+#endif
+
 	/* find out kernel image address */
 	if (argc < 2) {
 		img_addr = load_addr;
@@ -871,7 +1436,8 @@ static void *boot_get_kernel (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]
 	case IMAGE_FORMAT_LEGACY:
 		printf ("## Booting kernel from Legacy Image at %08lx ...\n",
 				img_addr);
-		hdr = image_get_kernel (img_addr, images->verify);
+		hdr = image_get_kernel (img_addr, images->verify,
+					&images->dcrc_on_load);
 		if (!hdr)
 			return NULL;
 		show_boot_progress (5);
@@ -1004,6 +1570,13 @@ U_BOOT_CMD(
 	"\taddr#<conf_uname>   - configuration specification\n"
 	"\tUse iminfo command to get the list of existing component\n"
 	"\timages and configurations.\n"
+#endif
+#ifdef BOOTM_SF
+	"\t\nA kernel image in SPI flash can be given as sf:<offset>;\n"
+	"\tit is read and decompressed in one pass to its load address.\n"
+#if defined(CONFIG_FIT)
+	"\tFor a FIT, sf:<offset>#<conf_uname> picks the configuration.\n"
+#endif
 #endif
 	"\nSub-commands to do part of the bootm sequence.  The sub-commands "
 	"must be\n"
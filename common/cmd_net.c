@@ -27,6 +27,9 @@
 #include <common.h>
 #include <command.h>
 #include <net.h>
+#ifdef CONFIG_SPI_FLASH_STREAM
+#include <spi_flash.h>
+#endif
 
 extern int do_bootm (cmd_tbl_t *, int, int, char *[]);
 
@@ -52,6 +55,10 @@ U_BOOT_CMD(
 	tftpboot,	3,	1,	do_tftpb,
 	"boot image via network using TFTP protocol",
 	"[loadAddress] [[hostIPaddr:]bootfilename]"
+#ifdef CONFIG_SPI_FLASH_STREAM
+	"\ntftpboot sf:offset[+len] [hostIPaddr:]bootfilename\n"
+	"    - write the file straight into SPI flash at offset"
+#endif
 );
 
 int do_rarpb (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
@@ -65,6 +72,23 @@ U_BOOT_CMD(
 	"[loadAddress] [[hostIPaddr:]bootfilename]"
 );
 
+#if defined(CONFIG_CMD_WGET)
+int do_wget (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	return netboot_common (WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"boot image via network using HTTP",
+	"[loadAddress] [[http://]hostIPaddr[:port]]/path"
+#ifdef CONFIG_SPI_FLASH_STREAM
+	"\nwget sf:offset[+len] [[http://]hostIPaddr[:port]]/path\n"
+	"    - write the file straight into SPI flash at offset"
+#endif
+);
+#endif
+
 #if defined(CONFIG_CMD_DHCP)
 int do_dhcp (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
@@ -150,6 +174,70 @@ static void netboot_update_env (void)
 #endif
 }
 
+#ifdef CONFIG_SPI_FLASH_STREAM
+#ifndef CONFIG_SF_DEFAULT_BUS
+# define CONFIG_SF_DEFAULT_BUS		0
+#endif
+#ifndef CONFIG_SF_DEFAULT_CS
+# define CONFIG_SF_DEFAULT_CS		0
+#endif
+#ifndef CONFIG_SF_DEFAULT_SPEED
+# define CONFIG_SF_DEFAULT_SPEED	1000000
+#endif
+#ifndef CONFIG_SF_DEFAULT_MODE
+# define CONFIG_SF_DEFAULT_MODE		SPI_MODE_3
+#endif
+
+/*
+ * TFTP or wget a file into SPI flash at "<offset>[+<len>]".  The region is
+ * erased as the data arrives; with a length it is erased up front while
+ * the transfer runs, and the file must fit in it.
+ */
+static int netboot_sf (proto_t proto, const char *arg, char *file)
+{
+	struct spi_flash_stream stream;
+	struct spi_flash *flash;
+	char *end;
+	ulong offset, len = 0;
+	int size;
+
+	offset = simple_strtoul (arg, &end, 16);
+	if (*end == '+')
+		len = simple_strtoul (end + 1, &end, 16);
+	if (end == arg || *end != '\0') {
+		printf ("Bad flash offset \"%s\"\n", arg);
+		return 1;
+	}
+
+	flash = spi_flash_probe (CONFIG_SF_DEFAULT_BUS, CONFIG_SF_DEFAULT_CS,
+			CONFIG_SF_DEFAULT_SPEED, CONFIG_SF_DEFAULT_MODE);
+	if (!flash) {
+		puts ("Failed to initialize SPI flash\n");
+		return 1;
+	}
+
+	if (spi_flash_stream_init (&stream, flash, offset, len)) {
+		spi_flash_free (flash);
+		return 1;
+	}
+
+	copy_filename (BootFile, file, sizeof(BootFile));
+
+	NetFlashStream = &stream;
+	size = NetLoop (proto);
+	NetFlashStream = NULL;
+
+	spi_flash_stream_end (&stream);
+	spi_flash_free (flash);
+
+	if (size < 0)
+		return 1;
+
+	netboot_update_env ();
+	return 0;
+}
+#endif
+
 static int
 netboot_common (proto_t proto, cmd_tbl_t *cmdtp, int argc, char *argv[])
 {
@@ -181,7 +269,13 @@ netboot_common (proto_t proto, cmd_tbl_t *cmdtp, int argc, char *argv[])
 			copy_filename(BootFile, argv[1], sizeof(BootFile));
 		break;
 
-	case 3:	load_addr = simple_strtoul(argv[1], NULL, 16);
+	case 3:
+#ifdef CONFIG_SPI_FLASH_STREAM
+		if ((proto == TFTP || proto == WGET) &&
+		    strncmp (argv[1], "sf:", 3) == 0)
+			return netboot_sf (proto, argv[1] + 3, argv[2]);
+#endif
+		load_addr = simple_strtoul(argv[1], NULL, 16);
 		copy_filename (BootFile, argv[2], sizeof(BootFile));
 
 		break;
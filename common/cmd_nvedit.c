@@ -93,6 +93,41 @@ int get_env_id (void)
 {
 	return env_id;
 }
+
+#ifdef CONFIG_ENV_HASH
+/*
+ * The index (common/env_hash.c) only covers the relocated RAM copy, and
+ * is only trusted while env_hash_id matches env_id; otherwise lookups
+ * fall back to the linear search.
+ */
+static int env_hash_id;		/* env_id the index describes, 0 if none */
+
+void env_hash_rebuild (void)
+{
+	env_hash_id = 0;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return;
+
+	if (env_hash_build(env_get_addr(0), ENV_SIZE) == 0)
+		env_hash_id = env_id;
+}
+
+/*
+ * Return the offset of the value of variable "name", -1 if it is not
+ * set, or -2 if the index is not usable and the caller must search.
+ */
+static int env_hash_lookup (char *name)
+{
+	if (env_hash_id != env_id || !(gd->flags & GD_FLG_RELOC))
+		return -2;
+
+	return env_hash_find(env_get_addr(0), name);
+}
+#else
+static inline void env_hash_rebuild (void) {}
+static inline int env_hash_lookup (char *name) { return -2; }
+#endif /* CONFIG_ENV_HASH */
 /************************************************************************
  * Command interface: print one or all environment variables
  */
@@ -314,6 +349,7 @@ int _do_setenv (int flag, int argc, char *argv[])
 	/* Delete only ? */
 	if ((argc < 3) || argv[2] == NULL) {
 		env_crc_update ();
+		env_hash_rebuild ();
 		return 0;
 	}
 
@@ -353,6 +389,7 @@ int _do_setenv (int flag, int argc, char *argv[])
 
 	/* Update CRC */
 	env_crc_update ();
+	env_hash_rebuild ();
 
 	/*
 	 * Some variables should be updated when the corresponding
@@ -540,51 +577,55 @@ int do_editenv(cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
  * or NULL if not found
  */
 
-char *getenv (char *name)
+/*
+ * Return the offset of the value of variable "name", or -1
+ */
+static int env_find (char *name)
 {
-	int i, nxt;
+	int i, nxt, val;
 
-	WATCHDOG_RESET();
+	if ((val = env_hash_lookup(name)) != -2)
+		return (val);
 
 	for (i=0; env_get_char(i) != '\0'; i=nxt+1) {
-		int val;
-
 		for (nxt=i; env_get_char(nxt) != '\0'; ++nxt) {
 			if (nxt >= CONFIG_ENV_SIZE) {
-				return (NULL);
+				return (-1);
 			}
 		}
-		if ((val=envmatch((uchar *)name, i)) < 0)
-			continue;
-		return ((char *)env_get_addr(val));
+		if ((val=envmatch((uchar *)name, i)) >= 0)
+			return (val);
 	}
 
-	return (NULL);
+	return (-1);
+}
+
+char *getenv (char *name)
+{
+	int val;
+
+	WATCHDOG_RESET();
+
+	if ((val = env_find(name)) < 0)
+		return (NULL);
+
+	return ((char *)env_get_addr(val));
 }
 
 int getenv_r (char *name, char *buf, unsigned len)
 {
-	int i, nxt;
+	int val, n;
 
-	for (i=0; env_get_char(i) != '\0'; i=nxt+1) {
-		int val, n;
+	if ((val = env_find(name)) < 0)
+		return (-1);
 
-		for (nxt=i; env_get_char(nxt) != '\0'; ++nxt) {
-			if (nxt >= CONFIG_ENV_SIZE) {
-				return (-1);
-			}
-		}
-		if ((val=envmatch((uchar *)name, i)) < 0)
-			continue;
-		/* found; copy out */
-		n = 0;
-		while ((len > n++) && (*buf++ = env_get_char(val++)) != '\0')
-			;
-		if (len == n)
-			*buf = '\0';
-		return (n);
-	}
-	return (-1);
+	/* found; copy out */
+	n = 0;
+	while ((len > n++) && (*buf++ = env_get_char(val++)) != '\0')
+		;
+	if (len == n)
+		*buf = '\0';
+	return (n);
 }
 
 #if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_ENV_IS_NOWHERE)
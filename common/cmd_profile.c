@@ -0,0 +1,197 @@
+/*
+ * Sampling profiler
+ *
+ * The architecture's timer interrupt hands the interrupted PC to
+ * profile_sample(), which counts it in a histogram covering the U-Boot
+ * text (__text_start .. __text_end from the linker script), one counter
+ * per 1 << CONFIG_PROFILE_SHIFT bytes.  "profile report" folds the
+ * buckets into functions with the kallsyms table and prints the busiest.
+ *
+ * Code running with interrupts disabled is not seen.
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+
+#ifndef CONFIG_PROFILE_SHIFT
+#define CONFIG_PROFILE_SHIFT	4
+#endif
+
+#ifndef CONFIG_PROFILE_TOP
+#define CONFIG_PROFILE_TOP	20
+#endif
+
+extern char __text_start[], __text_end[];
+
+static ulong *prof_hist;
+static ulong prof_buckets;
+static volatile int prof_running;
+static ulong prof_total;
+static ulong prof_outside;
+
+void profile_sample (ulong pc)
+{
+	ulong bucket;
+
+	if (!prof_running)
+		return;
+
+	prof_total++;
+	bucket = (pc - (ulong)__text_start) >> CONFIG_PROFILE_SHIFT;
+	if (bucket < prof_buckets)
+		prof_hist[bucket]++;
+	else
+		prof_outside++;
+}
+
+static int profile_start (void)
+{
+	prof_running = 0;
+
+	if (!prof_hist) {
+		prof_buckets = (((ulong)__text_end - (ulong)__text_start) >>
+				CONFIG_PROFILE_SHIFT) + 1;
+		prof_hist = malloc (prof_buckets * sizeof (ulong));
+		if (!prof_hist) {
+			printf ("profile: can't allocate %lu buckets\n",
+				prof_buckets);
+			return 1;
+		}
+	}
+
+	memset (prof_hist, 0, prof_buckets * sizeof (ulong));
+	prof_total = 0;
+	prof_outside = 0;
+	prof_running = 1;
+
+	return 0;
+}
+
+struct prof_func {
+	ulong		addr;
+	const char	*name;
+	ulong		count;
+};
+
+/* Keep the CONFIG_PROFILE_TOP busiest functions, busiest first */
+static void profile_keep (struct prof_func *top, int *ntop,
+			  const struct prof_func *f)
+{
+	int i;
+
+	if (!f->count)
+		return;
+
+	for (i = *ntop; i > 0 && top[i - 1].count < f->count; i--) {
+		if (i < CONFIG_PROFILE_TOP)
+			top[i] = top[i - 1];
+	}
+	if (i < CONFIG_PROFILE_TOP) {
+		top[i] = *f;
+		if (*ntop < CONFIG_PROFILE_TOP)
+			(*ntop)++;
+	}
+}
+
+static void profile_report (void)
+{
+	struct prof_func top[CONFIG_PROFILE_TOP];
+	struct prof_func cur;
+	ulong b, addr, caddr;
+	const char *name;
+	int ntop = 0;
+	int i;
+
+	if (!prof_total) {
+		puts ("profile: no samples\n");
+		return;
+	}
+
+	/* buckets are in address order, so a function's are adjacent */
+	memset (&cur, 0, sizeof (cur));
+	for (b = 0; b < prof_buckets; b++) {
+		if (!prof_hist[b])
+			continue;
+
+		addr = (ulong)__text_start + (b << CONFIG_PROFILE_SHIFT);
+#ifdef CONFIG_KALLSYMS
+		name = symbol_lookup (addr, &caddr);
+#else
+		name = NULL;
+#endif
+		if (!name) {
+			/* no symbols, report each bucket on its own */
+			name = "?";
+			caddr = addr;
+		}
+
+		if (caddr != cur.addr || !cur.count) {
+			profile_keep (top, &ntop, &cur);
+			cur.addr = caddr;
+			cur.name = name;
+			cur.count = 0;
+		}
+		cur.count += prof_hist[b];
+	}
+	profile_keep (top, &ntop, &cur);
+
+	printf ("%lu samples, %lu outside U-Boot text\n",
+		prof_total, prof_outside);
+	puts ("  Samples      %  Address   Function\n");
+	for (i = 0; i < ntop; i++)
+		printf ("%9lu %3lu.%lu  %08lx  %s\n", top[i].count,
+			top[i].count * 100 / prof_total,
+			(top[i].count * 1000 / prof_total) % 10,
+			top[i].addr, top[i].name);
+}
+
+int do_profile (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	if (argc != 2) {
+		cmd_usage (cmdtp);
+		return 1;
+	}
+
+	if (strcmp (argv[1], "start") == 0)
+		return profile_start ();
+
+	if (strcmp (argv[1], "stop") == 0) {
+		prof_running = 0;
+		return 0;
+	}
+
+	if (strcmp (argv[1], "report") == 0) {
+		profile_report ();
+		return 0;
+	}
+
+	cmd_usage (cmdtp);
+	return 1;
+}
+
+U_BOOT_CMD(
+	profile,	2,	0,	do_profile,
+	"sampling profiler",
+	"start  - clear the histogram and start sampling\n"
+	"profile stop   - stop sampling\n"
+	"profile report - print the functions with the most samples"
+);
@@ -27,6 +27,11 @@
 
 #include <common.h>
 #include <command.h>
+#ifdef CONFIG_SYS_SORTED_CMD_TABLE
+#include <malloc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+#endif
 
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
@@ -132,9 +137,108 @@ cmd_tbl_t *find_cmd_tbl (const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_SYS_SORTED_CMD_TABLE
+/*
+ * The linker places commands in .u_boot_cmd in link order, and every
+ * board has its own linker script, so instead of sorting the section we
+ * build a name-sorted array of pointers into it the first time a command
+ * is looked up after relocation, and binary search that.  The last
+ * successful lookup is remembered, since scripts tend to repeat the
+ * same command.
+ */
+#define CMD_LAST_HIT_LEN	16
+
+static cmd_tbl_t **cmd_index;
+static int cmd_index_len;
+static cmd_tbl_t *cmd_last_hit;
+static char cmd_last_name[CMD_LAST_HIT_LEN];
+
+static int cmd_index_build (void)
+{
+	cmd_tbl_t *cmdtp;
+	int i, j, n;
+
+	n = &__u_boot_cmd_end - &__u_boot_cmd_start;
+	cmd_index = malloc(n * sizeof(cmd_tbl_t *));
+	if (!cmd_index)
+		return -1;
+
+	/* Insertion sort; done once and the table is mostly small */
+	for (i = 0, cmdtp = &__u_boot_cmd_start; i < n; i++, cmdtp++) {
+		for (j = i; j > 0 &&
+		     strcmp(cmd_index[j - 1]->name, cmdtp->name) > 0; j--)
+			cmd_index[j] = cmd_index[j - 1];
+		cmd_index[j] = cmdtp;
+	}
+	cmd_index_len = n;
+
+	return 0;
+}
+
+/* Compare the first len characters of cmd, as a string, against name */
+static int cmd_name_cmp (const char *cmd, int len, const char *name)
+{
+	int r = strncmp(cmd, name, len);
+
+	if (r)
+		return r;
+	return name[len] ? -1 : 0;
+}
+
+static cmd_tbl_t *find_cmd_sorted (const char *cmd, int len)
+{
+	int lo = 0, hi = cmd_index_len;
+
+	/* Find the first entry not sorting below cmd */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (cmd_name_cmp(cmd, len, cmd_index[mid]->name) > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == cmd_index_len || strncmp(cmd, cmd_index[lo]->name, len))
+		return NULL;			/* not found */
+	if (cmd_index[lo]->name[len] == '\0')
+		return cmd_index[lo];		/* full match */
+
+	/* Abbreviations sort together; accept only a unique one */
+	if (lo + 1 < cmd_index_len &&
+	    strncmp(cmd, cmd_index[lo + 1]->name, len) == 0)
+		return NULL;			/* ambiguous command */
+
+	return cmd_index[lo];
+}
+#endif /* CONFIG_SYS_SORTED_CMD_TABLE */
+
 cmd_tbl_t *find_cmd (const char *cmd)
 {
 	int len = &__u_boot_cmd_end - &__u_boot_cmd_start;
+#ifdef CONFIG_SYS_SORTED_CMD_TABLE
+	cmd_tbl_t *cmdtp;
+	const char *p;
+	int n;
+
+	if ((gd->flags & GD_FLG_RELOC) &&
+	    (cmd_index || cmd_index_build() == 0)) {
+		n = ((p = strchr(cmd, '.')) == NULL) ? strlen (cmd) : (p - cmd);
+
+		if (cmd_last_hit && n < CMD_LAST_HIT_LEN &&
+		    strncmp(cmd, cmd_last_name, n) == 0 &&
+		    cmd_last_name[n] == '\0')
+			return cmd_last_hit;
+
+		cmdtp = find_cmd_sorted(cmd, n);
+		if (cmdtp && n < CMD_LAST_HIT_LEN) {
+			memcpy(cmd_last_name, cmd, n);
+			cmd_last_name[n] = '\0';
+			cmd_last_hit = cmdtp;
+		}
+		return cmdtp;
+	}
+#endif
 	return find_cmd_tbl(cmd, &__u_boot_cmd_start, len);
 }
 
@@ -264,6 +264,10 @@ void env_relocate (void)
 	}
 	gd->env_addr = (ulong)&(env_ptr->data);
 
+#ifdef CONFIG_ENV_HASH
+	env_hash_rebuild();
+#endif
+
 #ifdef CONFIG_AMIGAONEG3SE
 	disable_nvram();
 #endif
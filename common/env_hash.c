@@ -0,0 +1,116 @@
+/*
+ * Hash index over the RAM copy of the environment
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * An open addressed (linear probing) table of offsets to the start of
+ * each "name=value" entry, keyed by a hash of the variable name, so that
+ * getenv() does not have to walk every string on each lookup.  It works
+ * on a plain buffer so that tools/env_hash_bench can run the same code
+ * on the build host; cmd_nvedit.c decides when the index is valid.
+ */
+
+#ifndef USE_HOSTCC
+#include <common.h>
+#else
+#define	__ASSEMBLY__			/* Dirty trick to get only #defines	*/
+#define	__ASM_STUB_PROCESSOR_H__	/* don't include asm/processor.		*/
+#include <config.h>
+#undef	__ASSEMBLY__
+#endif
+#include <environment.h>
+
+#ifndef CONFIG_ENV_HASH_SIZE
+#define CONFIG_ENV_HASH_SIZE	256	/* must be a power of 2 */
+#endif
+#define ENV_HASH_MASK	(CONFIG_ENV_HASH_SIZE - 1)
+#define ENV_HASH_EMPTY	(-1)
+
+static int env_hash_table[CONFIG_ENV_HASH_SIZE];
+
+/* Hash a variable name terminated by '=' or '\0' */
+static unsigned int env_hash_name (const unsigned char *s)
+{
+	unsigned int h = 0;
+
+	while (*s != '\0' && *s != '=')
+		h = h * 31 + *s++;
+
+	return h;
+}
+
+int env_hash_build (const unsigned char *env, int size)
+{
+	int i, nxt, used;
+
+	for (i = 0; i < CONFIG_ENV_HASH_SIZE; i++)
+		env_hash_table[i] = ENV_HASH_EMPTY;
+
+	used = 0;
+	for (i = 0; env[i] != '\0'; i = nxt + 1) {
+		unsigned int h;
+
+		for (nxt = i; env[nxt] != '\0'; ++nxt) {
+			if (nxt >= size)
+				return -1;
+		}
+
+		/* Keep probe chains short; too many variables disables it */
+		if (++used > CONFIG_ENV_HASH_SIZE * 3 / 4)
+			return -1;
+
+		h = env_hash_name(&env[i]) & ENV_HASH_MASK;
+		while (env_hash_table[h] != ENV_HASH_EMPTY)
+			h = (h + 1) & ENV_HASH_MASK;
+		env_hash_table[h] = i;
+	}
+
+	return 0;
+}
+
+/* Same as envmatch(), on the buffer */
+static int
+env_hash_match (const unsigned char *env, const unsigned char *name, int i)
+{
+	while (*name == env[i++])
+		if (*name++ == '=')
+			return i;
+	if (*name == '\0' && env[i - 1] == '=')
+		return i;
+	return -1;
+}
+
+int env_hash_find (const unsigned char *env, const char *name)
+{
+	unsigned int h;
+	int val;
+
+	h = env_hash_name((const unsigned char *)name) & ENV_HASH_MASK;
+	while (env_hash_table[h] != ENV_HASH_EMPTY) {
+		val = env_hash_match(env, (const unsigned char *)name,
+				     env_hash_table[h]);
+		if (val >= 0)
+			return val;
+		h = (h + 1) & ENV_HASH_MASK;
+	}
+
+	return -1;
+}
@@ -58,6 +58,252 @@ uchar env_get_char_spec(int index)
 	return *((uchar *)(gd->env_addr + index));
 }
 
+#ifdef CONFIG_ENV_SPI_LOG
+/*
+ * Append-only environment log.
+ *
+ * Each environment sector holds a sequence of records, every one of which
+ * is a header followed by the used part of the environment data, padded
+ * out to CONFIG_ENV_SPI_LOG_ALIGN.  saveenv() appends a new record after
+ * the last one; the sector is only erased when it has no room left, at
+ * which point the record is written to the start of the other sector
+ * (CONFIG_ENV_OFFSET_REDUND) after erasing it.  The previously active
+ * sector is left untouched until the next roll-over, so a power failure
+ * during a save always leaves at least one intact copy.  The record with
+ * the highest sequence number and a good CRC wins at boot.
+ */
+#ifndef CONFIG_ENV_OFFSET_REDUND
+# error "CONFIG_ENV_SPI_LOG requires CONFIG_ENV_OFFSET_REDUND"
+#endif
+#ifndef CONFIG_ENV_SPI_LOG_ALIGN
+# define CONFIG_ENV_SPI_LOG_ALIGN	256	/* one program page */
+#endif
+
+#define ENV_LOG_MAGIC		0x454e564c	/* "ENVL" */
+#define ENV_LOG_ERASED		0xffffffff
+
+struct env_log_hdr {
+	uint32_t magic;
+	uint32_t seq;		/* save counter, increases across sectors */
+	uint32_t len;		/* bytes of environment data that follow */
+	uint32_t crc;		/* CRC32 of the environment data */
+	uint32_t hcrc;		/* CRC32 of the fields above */
+};
+
+#define ENV_LOG_HCRC_LEN	offsetof(struct env_log_hdr, hcrc)
+#define ENV_LOG_REC_SIZE(len)	\
+	roundup(sizeof(struct env_log_hdr) + (len), CONFIG_ENV_SPI_LOG_ALIGN)
+
+static const u32 env_log_sectors[2] = {
+	CONFIG_ENV_OFFSET, CONFIG_ENV_OFFSET_REDUND
+};
+
+static int env_log_active;	/* index into env_log_sectors */
+static u32 env_log_next;	/* free offset in the active sector */
+static u32 env_log_seq;		/* sequence number of the last record */
+
+/* Length of the environment data actually in use, including the final NUL */
+static u32 env_log_used(void)
+{
+	u32 i;
+
+	for (i = 0; i + 1 < ENV_SIZE; i++) {
+		if (env_ptr->data[i] == '\0' && env_ptr->data[i + 1] == '\0')
+			return i + 2;
+	}
+
+	return ENV_SIZE;
+}
+
+static int env_log_read_record(u32 sect, u32 off, struct env_log_hdr *hdr)
+{
+	if (hdr->len > ENV_SIZE)
+		return 1;
+
+	memset(env_ptr, 0, sizeof(env_t));
+	if (spi_flash_read(env_flash, sect + off + sizeof(*hdr), hdr->len,
+			   env_ptr->data))
+		return 1;
+
+	if (crc32(0, env_ptr->data, hdr->len) != hdr->crc)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * Walk the records in one sector.  On return *next holds the first free
+ * offset (CONFIG_ENV_SECT_SIZE if the sector is full or damaged), and the
+ * newest record with intact data has been loaded into env_ptr.  Only the
+ * last record can have been interrupted by a power failure, so falling back
+ * one record is sufficient.  Returns 0 and the record's sequence number in
+ * *seq if a record was loaded.
+ */
+static int env_log_scan(u32 sect, u32 *next, u32 *seq)
+{
+	struct env_log_hdr hdr, last, prev;
+	u32 last_off = 0, prev_off = 0;
+	int found = 0;
+	u32 off = 0;
+
+	memset(&last, 0, sizeof(last));
+	while (off + sizeof(hdr) <= CONFIG_ENV_SECT_SIZE) {
+		if (spi_flash_read(env_flash, sect + off, sizeof(hdr), &hdr)) {
+			off = CONFIG_ENV_SECT_SIZE;
+			break;
+		}
+
+		if (hdr.magic == ENV_LOG_ERASED) {
+			/* A partially programmed header closes the sector */
+			if (hdr.seq != ENV_LOG_ERASED ||
+			    hdr.len != ENV_LOG_ERASED ||
+			    hdr.crc != ENV_LOG_ERASED ||
+			    hdr.hcrc != ENV_LOG_ERASED)
+				off = CONFIG_ENV_SECT_SIZE;
+			break;
+		}
+
+		if (hdr.magic != ENV_LOG_MAGIC || hdr.len > ENV_SIZE ||
+		    crc32(0, (uchar *)&hdr, ENV_LOG_HCRC_LEN) != hdr.hcrc) {
+			off = CONFIG_ENV_SECT_SIZE;
+			break;
+		}
+
+		prev = last;
+		prev_off = last_off;
+		last = hdr;
+		last_off = off;
+		found++;
+
+		off += ENV_LOG_REC_SIZE(hdr.len);
+	}
+
+	*next = min(off, (u32)CONFIG_ENV_SECT_SIZE);
+
+	if (found >= 1 && !env_log_read_record(sect, last_off, &last)) {
+		*seq = last.seq;
+		return 0;
+	}
+	if (found >= 2 && !env_log_read_record(sect, prev_off, &prev)) {
+		*seq = prev.seq;
+		return 0;
+	}
+
+	return 1;
+}
+
+int saveenv(void)
+{
+	struct env_log_hdr *hdr;
+	u32 len, rec_size, sect;
+	uchar *rec;
+	int ret;
+
+	if (!env_flash) {
+		puts("Environment SPI flash not initialized\n");
+		return 1;
+	}
+
+	len = env_log_used();
+	rec_size = ENV_LOG_REC_SIZE(len);
+	if (rec_size > CONFIG_ENV_SECT_SIZE) {
+		puts("Environment too large for SPI flash sector\n");
+		return 1;
+	}
+
+	rec = malloc(sizeof(*hdr) + len);
+	if (!rec)
+		return 1;
+
+	hdr = (struct env_log_hdr *)rec;
+	hdr->magic = ENV_LOG_MAGIC;
+	hdr->seq = env_log_seq + 1;
+	hdr->len = len;
+	hdr->crc = crc32(0, env_ptr->data, len);
+	hdr->hcrc = crc32(0, (uchar *)hdr, ENV_LOG_HCRC_LEN);
+	memcpy(rec + sizeof(*hdr), env_ptr->data, len);
+
+	if (env_log_next + rec_size > CONFIG_ENV_SECT_SIZE) {
+		/* Active sector is full; roll over to the other one */
+		sect = env_log_sectors[!env_log_active];
+
+		puts("Erasing SPI flash...");
+		ret = spi_flash_erase(env_flash, sect, CONFIG_ENV_SECT_SIZE);
+		if (ret)
+			goto done;
+
+		env_log_active = !env_log_active;
+		env_log_next = 0;
+	}
+	sect = env_log_sectors[env_log_active];
+
+	puts("Writing to SPI flash...");
+	ret = spi_flash_write(env_flash, sect + env_log_next,
+			      sizeof(*hdr) + len, rec);
+
+	/* Never append over a record whose programming may have failed */
+	env_log_next += rec_size;
+	if (ret)
+		goto done;
+
+	env_log_seq = hdr->seq;
+	puts("done\n");
+
+ done:
+	free(rec);
+	return ret;
+}
+
+void env_relocate_spec(void)
+{
+	u32 next[2], seq[2];
+	int valid[2];
+	int i;
+
+	env_flash = spi_flash_probe(CONFIG_ENV_SPI_BUS, CONFIG_ENV_SPI_CS,
+			CONFIG_ENV_SPI_MAX_HZ, CONFIG_ENV_SPI_MODE);
+	if (!env_flash)
+		goto err_probe;
+
+	for (i = 0; i < 2; i++)
+		valid[i] = !env_log_scan(env_log_sectors[i], &next[i], &seq[i]);
+
+	if (valid[0] || valid[1]) {
+		/* The newest copy wins; the first scan's copy is overwritten */
+		i = valid[1] && (!valid[0] || (int)(seq[1] - seq[0]) > 0);
+		if (i == 0 && valid[1])
+			env_log_scan(env_log_sectors[0], &next[0], &seq[0]);
+
+		env_log_active = i;
+		env_log_next = next[i];
+		env_log_seq = seq[i];
+		env_crc_update();
+		gd->env_valid = 1;
+		return;
+	}
+
+	/*
+	 * No log records yet: accept a plain env_t image left in the first
+	 * sector by an older U-Boot, and close that sector so the first save
+	 * goes to the redundant one and leaves the old copy intact.
+	 */
+	env_log_active = 0;
+	env_log_next = next[0];
+	env_log_seq = 0;
+	if (!spi_flash_read(env_flash, CONFIG_ENV_OFFSET, CONFIG_ENV_SIZE,
+			    env_ptr) &&
+	    crc32(0, env_ptr->data, ENV_SIZE) == env_ptr->crc) {
+		env_log_next = CONFIG_ENV_SECT_SIZE;
+		gd->env_valid = 1;
+		return;
+	}
+
+err_probe:
+	puts("*** Warning - bad CRC, using default environment\n\n");
+
+	set_default_env();
+}
+#else /* !CONFIG_ENV_SPI_LOG */
 int saveenv(void)
 {
 	u32 saved_size, saved_offset;
@@ -145,6 +391,8 @@ err_crc:
 	set_default_env();
 }
 
+#endif /* CONFIG_ENV_SPI_LOG */
+
 int env_init(void)
 {
 	/* SPI flash isn't usable before relocation */
@@ -3223,6 +3223,224 @@ int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#ifdef CONFIG_HUSH_CACHE
+/*
+ * Cache of parsed scripts, so that "run" and "bootcmd" do not re-tokenise
+ * the same text every time it is executed.  Entries are keyed by the
+ * script text itself, so changing the variable a script came from simply
+ * produces a miss; variable references are expanded at run time and are
+ * not part of the cached parse.  Scripts whose parse tree is modified
+ * while running ("for" loops and assignments) are not cached.
+ */
+#ifndef CONFIG_HUSH_CACHE_ENTRIES
+#define CONFIG_HUSH_CACHE_ENTRIES	8
+#endif
+
+struct script_cache {
+	char *src;			/* copy of the script text */
+	unsigned int hash;
+	struct pipe *list;		/* parsed pipelines */
+	int busy;			/* nesting depth of running copies */
+	unsigned long used;		/* last use, for LRU replacement */
+};
+
+static struct script_cache script_cache[CONFIG_HUSH_CACHE_ENTRIES];
+static unsigned long script_cache_clock;
+static unsigned long script_cache_hits, script_cache_misses;
+static unsigned long script_parse_ms, script_run_ms;
+
+static unsigned int script_hash(const char *s)
+{
+	unsigned int h = 0;
+
+	while (*s)
+		h = h * 31 + (unsigned char)*s++;
+
+	return h;
+}
+
+static int script_cacheable(struct pipe *head)
+{
+	struct pipe *pi;
+	int i;
+
+	for (pi = head; pi; pi = pi->next) {
+		if (pi->r_mode == RES_FOR || pi->r_mode == RES_IN)
+			return 0;
+		for (i = 0; i < pi->num_progs; i++) {
+			struct child_prog *child = &pi->progs[i];
+
+			if (child->group && !script_cacheable(child->group))
+				return 0;
+			if (child->argv && is_assignment(child->argv[0]))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void script_cache_drop(struct script_cache *sc)
+{
+	free_pipe_list(sc->list, 0);
+	free(sc->src);
+	sc->list = NULL;
+	sc->src = NULL;
+}
+
+/* Parse the first line of s into a pipe list, NULL on error or interrupt */
+static struct pipe *parse_string_list(char *s, int flag)
+{
+	struct p_context ctx;
+	struct in_str input;
+	o_string temp = NULL_O_STRING;
+	int rcode;
+
+	setup_string_in_str(&input, s);
+	ctx.type = flag;
+	initialize_context(&ctx);
+	update_ifs_map();
+	if (!(flag & FLAG_PARSE_SEMICOLON))
+		mapset((uchar *)";$&|", 0);
+	input.promptmode = 1;
+	rcode = parse_stream(&temp, &ctx, &input, '\n');
+	if (rcode == 1)
+		flag_repeat = 0;
+	if (rcode != 1 && ctx.old_flag != 0) {
+		syntax();
+		flag_repeat = 0;
+	}
+	if (rcode != 1 && ctx.old_flag == 0) {
+		done_word(&temp, &ctx);
+		done_pipe(&ctx, PIPE_SEQ);
+		b_free(&temp);
+		return ctx.list_head;
+	}
+
+	if (ctx.old_flag != 0) {
+		free(ctx.stack);
+		b_reset(&temp);
+	}
+	if (input.__promptme == 0)
+		printf("<INTERRUPT>\n");
+	free_pipe_list(ctx.list_head, 0);
+	b_free(&temp);
+	return NULL;
+}
+
+/*
+ * Equivalent of one pass of parse_stream_outer() over the first line
+ * of s, taking the parsed form from the cache when possible.
+ */
+static int parse_string_cached(char *s, int flag)
+{
+	struct script_cache *sc, *victim = NULL;
+	struct pipe *list;
+	unsigned int hash = script_hash(s);
+	char *p;
+	ulong start;
+	int code, i;
+
+	for (i = 0; i < CONFIG_HUSH_CACHE_ENTRIES; i++) {
+		sc = &script_cache[i];
+		if (sc->src && sc->hash == hash && !strcmp(sc->src, s))
+			break;
+		if (sc->busy)
+			continue;
+		if (!victim || !sc->src ||
+		    (victim->src && sc->used < victim->used))
+			victim = sc;
+	}
+
+	if (i < CONFIG_HUSH_CACHE_ENTRIES) {
+		script_cache_hits++;
+	} else {
+		script_cache_misses++;
+		sc = NULL;
+
+		start = get_timer(0);
+		if (!(p = strchr(s, '\n')) || *++p) {
+			p = xmalloc(strlen(s) + 2);
+			strcpy(p, s);
+			strcat(p, "\n");
+			list = parse_string_list(p, flag);
+			free(p);
+		} else {
+			list = parse_string_list(s, flag);
+		}
+		script_parse_ms += get_timer(start);
+		if (!list)
+			return 0;
+
+		if (victim && script_cacheable(list)) {
+			if (victim->src)
+				script_cache_drop(victim);
+			victim->src = xmalloc(strlen(s) + 1);
+			strcpy(victim->src, s);
+			victim->hash = hash;
+			victim->list = list;
+			sc = victim;
+		}
+	}
+
+	start = get_timer(0);
+	if (sc) {
+		sc->used = ++script_cache_clock;
+		sc->busy++;
+		code = run_list_real(sc->list);
+		sc->busy--;
+	} else {
+		code = run_list(list);
+	}
+	script_run_ms += get_timer(start);
+
+	if (code == -2)		/* exit */
+		code = 0;
+	if (code == -1)
+		flag_repeat = 0;
+
+	return (code != 0) ? 1 : 0;
+}
+
+int do_hushcache (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	int i, n;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "flush") != 0) {
+			cmd_usage(cmdtp);
+			return 1;
+		}
+		for (i = 0; i < CONFIG_HUSH_CACHE_ENTRIES; i++) {
+			if (script_cache[i].src && !script_cache[i].busy)
+				script_cache_drop(&script_cache[i]);
+		}
+		script_cache_hits = script_cache_misses = 0;
+		script_parse_ms = script_run_ms = 0;
+		return 0;
+	}
+
+	for (i = n = 0; i < CONFIG_HUSH_CACHE_ENTRIES; i++)
+		if (script_cache[i].src)
+			n++;
+
+	printf("Entries: %d/%d, hits: %lu, misses: %lu\n",
+	       n, CONFIG_HUSH_CACHE_ENTRIES,
+	       script_cache_hits, script_cache_misses);
+	printf("Parse time: %lu ms, run time: %lu ms\n",
+	       script_parse_ms, script_run_ms);
+	return 0;
+}
+
+U_BOOT_CMD(
+	hushcache, 2, 0, do_hushcache,
+	"show parsed script cache statistics",
+	"\n    - print cache hits/misses and time spent parsing vs. running\n"
+	"hushcache flush\n"
+	"    - discard all cached scripts and reset the statistics"
+);
+#endif /* CONFIG_HUSH_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3235,6 +3453,11 @@ int parse_string_outer(char *s, int flag)
 	int rcode;
 	if ( !s || !*s)
 		return 1;
+#ifdef CONFIG_HUSH_CACHE
+	/* Only a single pass is made; the parsed form can be reused */
+	if ((flag & FLAG_EXIT_FROM_LOOP) && !(flag & FLAG_REPARSING))
+		return parse_string_cached(s, flag);
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
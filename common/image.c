@@ -2292,7 +2292,9 @@ int fit_image_get_entry (const void *fit, int noffset, ulong *entry)
  *
  * fit_image_get_data() finds data property in a given component image node.
  * If the property is found its data start address and size are returned to
- * the caller.
+ * the caller.  For an image whose data is stored after the blob (see
+ * fit_image_get_data_ext()) the address is where that data lies if the
+ * whole FIT is in memory.
  *
  * returns:
  *     0, on success
@@ -2302,18 +2304,89 @@ int fit_image_get_data (const void *fit, int noffset,
 		const void **data, size_t *size)
 {
 	int len;
+	ulong offset;
 
 	*data = fdt_getprop (fit, noffset, FIT_DATA_PROP, &len);
-	if (*data == NULL) {
-		fit_get_debug (fit, noffset, FIT_DATA_PROP, len);
-		*size = 0;
-		return -1;
+	if (*data != NULL) {
+		*size = len;
+		return 0;
 	}
 
-	*size = len;
+	if (fit_image_get_data_ext (fit, noffset, &offset, size) == 0) {
+		*data = (const char *)fit + fit_get_ext_base (fit) + offset;
+		return 0;
+	}
+
+	fit_get_debug (fit, noffset, FIT_DATA_PROP, len);
+	*size = 0;
+	return -1;
+}
+
+/**
+ * fit_image_get_data_ext - get location of external image data
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @offset: pointer to a ulong, will hold the data offset from
+ *          fit_get_ext_base()
+ * @size: pointer to size_t, will hold the data size
+ *
+ * fit_image_get_data_ext() finds the data-offset and data-size properties
+ * of an image node whose data is stored after the blob rather than in a
+ * data property.  Such a FIT can be loaded a piece at a time: the blob
+ * first, then only the image data that is needed.
+ *
+ * returns:
+ *     0, on success
+ *     -1, if the image has no external data
+ */
+int fit_image_get_data_ext (const void *fit, int noffset,
+		ulong *offset, size_t *size)
+{
+	const uint32_t *off, *sz;
+
+	off = fdt_getprop (fit, noffset, FIT_DATA_OFFSET_PROP, NULL);
+	sz = fdt_getprop (fit, noffset, FIT_DATA_SIZE_PROP, NULL);
+	if (off == NULL || sz == NULL)
+		return -1;
+
+	*offset = uimage_to_cpu (*off);
+	*size = uimage_to_cpu (*sz);
 	return 0;
 }
 
+/**
+ * fit_get_end - get FIT image end
+ * @fit: pointer to the FIT format image header
+ *
+ * returns:
+ *     end address of the FIT image in memory, including any image data
+ *     stored after the blob
+ */
+ulong fit_get_end (const void *fit)
+{
+	ulong end = fit_get_size (fit);
+	ulong offset;
+	size_t size;
+	int images_noffset, noffset, ndepth;
+
+	images_noffset = fdt_path_offset (fit, FIT_IMAGES_PATH);
+	if (images_noffset < 0)
+		return (ulong)fit + end;
+
+	for (ndepth = 0, noffset = fdt_next_node (fit, images_noffset, &ndepth);
+	     (noffset >= 0) && (ndepth > 0);
+	     noffset = fdt_next_node (fit, noffset, &ndepth)) {
+		if (ndepth != 1)
+			continue;
+		if (fit_image_get_data_ext (fit, noffset, &offset, &size))
+			continue;
+		if (fit_get_ext_base (fit) + offset + size > end)
+			end = fit_get_ext_base (fit) + offset + size;
+	}
+
+	return (ulong)fit + end;
+}
+
 /**
  * fit_image_hash_get_algo - get hash algorithm name
  * @fit: pointer to the FIT format image header
@@ -2700,6 +2773,150 @@ error:
 	return 0;
 }
 
+/**
+ * fit_image_hash_stream_start - set up hashing of image data as it is read
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ * @hs: hash state to set up
+ *
+ * fit_image_hash_stream_start() prepares a context for every hash subnode
+ * of the component image, so that its data can be fed through
+ * fit_image_hash_stream_update() a piece at a time while it is read or
+ * decompressed, instead of being hashed in one go afterwards.
+ *
+ * returns:
+ *     0, on success
+ *     -1, on an unsupported algorithm or too many hash nodes
+ */
+int fit_image_hash_stream_start (const void *fit, int image_noffset,
+		struct fit_hash_stream *hs)
+{
+	char	*algo;
+	int	noffset;
+	int	ndepth;
+	int	i;
+
+	hs->count = 0;
+	for (ndepth = 0, noffset = fdt_next_node (fit, image_noffset, &ndepth);
+	     (noffset >= 0) && (ndepth > 0);
+	     noffset = fdt_next_node (fit, noffset, &ndepth)) {
+		if (ndepth != 1 ||
+		    strncmp (fit_get_name (fit, noffset, NULL),
+				FIT_HASH_NODENAME,
+				strlen (FIT_HASH_NODENAME)) != 0)
+			continue;
+
+		if (fit_image_hash_get_algo (fit, noffset, &algo))
+			return -1;
+		if (hs->count == FIT_MAX_HASHES) {
+			debug ("Too many hash nodes\n");
+			return -1;
+		}
+
+		i = hs->count;
+		if (strcmp (algo, "crc32") == 0) {
+			hs->hash[i].ctx.crc32 = 0;
+		} else if (strcmp (algo, "sha1") == 0) {
+			sha1_starts (&hs->hash[i].ctx.sha1);
+		} else if (strcmp (algo, "md5") == 0) {
+			MD5Init (&hs->hash[i].ctx.md5);
+		} else {
+			debug ("Unsupported hash alogrithm\n");
+			return -1;
+		}
+		hs->hash[i].noffset = noffset;
+		hs->hash[i].algo = algo;
+		hs->count++;
+	}
+
+	return 0;
+}
+
+/**
+ * fit_image_hash_stream_update - hash the next piece of image data
+ * @hs: hash state set up by fit_image_hash_stream_start()
+ * @data: image data
+ * @len: number of bytes at data
+ */
+void fit_image_hash_stream_update (struct fit_hash_stream *hs,
+		const void *data, size_t len)
+{
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		switch (hs->hash[i].algo[0]) {
+		case 'c':
+			hs->hash[i].ctx.crc32 = crc32 (hs->hash[i].ctx.crc32,
+							data, len);
+			break;
+		case 's':
+			sha1_update (&hs->hash[i].ctx.sha1,
+					(unsigned char *)data, len);
+			break;
+		case 'm':
+			MD5Update (&hs->hash[i].ctx.md5, data, len);
+			break;
+		}
+	}
+}
+
+/**
+ * fit_image_hash_stream_check - verify hashes computed while reading
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ * @hs: hash state fed with all of the image data
+ *
+ * fit_image_hash_stream_check() is fit_image_check_hashes() for data that
+ * went through fit_image_hash_stream_update().
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise
+ */
+int fit_image_hash_stream_check (const void *fit, int image_noffset,
+		struct fit_hash_stream *hs)
+{
+	uint8_t		*fit_value;
+	int		fit_value_len;
+	uint8_t		value[FIT_MAX_HASH_LEN];
+	int		value_len;
+	int		i;
+
+	for (i = 0; i < hs->count; i++) {
+		printf ("%s", hs->hash[i].algo);
+
+		switch (hs->hash[i].algo[0]) {
+		case 'c':
+			*((uint32_t *)value) =
+				cpu_to_uimage (hs->hash[i].ctx.crc32);
+			value_len = 4;
+			break;
+		case 's':
+			sha1_finish (&hs->hash[i].ctx.sha1, value);
+			value_len = 20;
+			break;
+		default:
+			MD5Final (value, &hs->hash[i].ctx.md5);
+			value_len = 16;
+			break;
+		}
+
+		if (fit_image_hash_get_value (fit, hs->hash[i].noffset,
+					&fit_value, &fit_value_len) ||
+		    value_len != fit_value_len ||
+		    memcmp (value, fit_value, value_len) != 0) {
+			printf (" error!\nBad hash value for '%s' hash node "
+				"in '%s' image node\n",
+				fit_get_name (fit, hs->hash[i].noffset, NULL),
+				fit_get_name (fit, image_noffset, NULL));
+			return 0;
+		}
+		printf ("+ ");
+	}
+
+	return 1;
+}
+
 /**
  * fit_all_image_check_hashes - verify data intergity for all images
  * @fit: pointer to the FIT format image header
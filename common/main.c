@@ -30,6 +30,7 @@
 #include <common.h>
 #include <watchdog.h>
 #include <command.h>
+#include <bootstage.h>
 #ifdef CONFIG_MODEM_SUPPORT
 #include <malloc.h>		/* for free() prototype */
 #endif
@@ -328,6 +329,8 @@ void main_loop (void)
 	trab_vfd (bmp);
 #endif	/* CONFIG_VFD && VFD_TEST_LOGO */
 
+	bootstage_mark ("main_loop");
+
 #ifdef CONFIG_BOOTCOUNT_LIMIT
 	bootcount = bootcount_load();
 	bootcount++;
@@ -416,6 +419,7 @@ void main_loop (void)
      * is for -- bootdelay == 0 iff CONFIG_BOOTDELAY == 0). */
     bootdelay = 3;
   }
+  bootstage_mark ("firmware_update_check");
 #endif
 
 #if defined(CONFIG_GPIO_INIT)
@@ -437,6 +441,7 @@ void main_loop (void)
   labx_preboot_res = labx_preboot(bootdelay);
 	if(labx_preboot_res == -1) bootdelay = -1;
   else if(labx_preboot_res == 0) bootdelay = 0;
+  bootstage_mark ("labx_preboot");
 #endif
 
 #ifdef CONFIG_BOOTCOUNT_LIMIT
@@ -539,6 +539,9 @@ struct spi_flash *spi_flash_probe_atmel(struct spi_slave *spi, u8 *idcode)
 	asf->flash.size = page_size * params->pages_per_block
 				* params->blocks_per_sector
 				* params->nr_sectors;
+	/* DataFlash commands differ, no stream support */
+	asf->flash.page_size = 0;
+	asf->flash.sector_size = 0;
 
 	debug("SF: Detected %s with page size %lu, total %u bytes\n",
 			params->name, page_size, asf->flash.size);
@@ -329,6 +329,9 @@ struct spi_flash *spi_flash_probe_macronix(struct spi_slave *spi, u8 *idcode)
 	mcx->flash.read = macronix_read_fast;
 	mcx->flash.size = params->page_size * params->pages_per_sector
 	    * params->sectors_per_block * params->nr_blocks;
+	mcx->flash.page_size = params->page_size;
+	mcx->flash.sector_size = params->page_size * params->pages_per_sector
+	    * params->sectors_per_block;
 
 	printf("SF: Detected %s with page size %u, total %u bytes\n",
 	      params->name, params->page_size, mcx->flash.size);
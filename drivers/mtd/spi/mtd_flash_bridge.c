@@ -256,6 +256,8 @@ struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs,
 
   // TODO - What should the size be?  This is hard-coded to 16 MiB
 	bridged_flash->size = (16 * 1024 * 1024);
+	bridged_flash->page_size = 0;
+	bridged_flash->sector_size = 0;
 
 	printf("Created MTD bridge Flash device\n");
 
@@ -149,28 +149,8 @@ static const struct spansion_spi_flash_params spansion_spi_flash_table[] = {
 
 static int spansion_wait_ready(struct spi_flash *flash, unsigned long timeout)
 {
-	struct spi_slave *spi = flash->spi;
-	unsigned long timebase;
-	int ret;
-	u8 status;
-
-	timebase = get_timer(0);
-	do {
-		ret = spi_flash_cmd(spi, CMD_S25FLXX_RDSR, &status, sizeof(status));
-		if (ret)
-			return -1;
-
-		if ((status & SPANSION_SR_WIP) == 0)
-			break;
-
-	} while (get_timer(timebase) < timeout);
-
-
-	if ((status & SPANSION_SR_WIP) == 0)
-		return 0;
-
-	/* Timed out */
-	return -1;
+	return spi_flash_cmd_wait_ready(flash, CMD_S25FLXX_RDSR,
+					SPANSION_SR_WIP, timeout);
 }
 
 static int spansion_read_fast(struct spi_flash *flash,
@@ -297,6 +277,15 @@ static int spansion_write(struct spi_flash *flash,
 		//    ("PP: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x } chunk_len = %d\n",
 		//     buf + actual, cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
 
+		/* Previous page is programming while this one was staged */
+		if (actual) {
+			ret = spansion_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+			if (ret < 0) {
+				printf("SF: SPANSION page programming timed out\n");
+				break;
+			}
+		}
+
 		ret = spi_flash_cmd(flash->spi, CMD_S25FLXX_WREN, NULL, 0);
 		if (ret < 0) {
 			printf("SF: Enabling Write failed\n");
@@ -310,16 +299,16 @@ static int spansion_write(struct spi_flash *flash,
 			break;
 		}
 
-		ret = spansion_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret < 0) {
-			printf("SF: SPANSION page programming timed out\n");
-			break;
-		}
-
 		page_addr++;
 		byte_addr = 0;
 	}
 
+	if (ret == 0 && len) {
+		ret = spansion_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+		if (ret < 0)
+			printf("SF: SPANSION page programming timed out\n");
+	}
+
 	printf("SF: SPANSION: Successfully programmed %u bytes @ 0x%x\n",
 	      len, offset);
 
@@ -435,6 +424,8 @@ struct spi_flash *spi_flash_probe_spansion(struct spi_slave *spi, u8 *idcode)
 	spsn->flash.rotp = spansion_read_otp;
 	spsn->flash.size = params->page_size * params->pages_per_sector
 	    * params->nr_sectors;
+	spsn->flash.page_size = params->page_size;
+	spsn->flash.sector_size = params->page_size * params->pages_per_sector;
 
 	printf("SF: Detected %s with page size %u, total %u bytes\n",
 	      params->name, params->page_size, spsn->flash.size);
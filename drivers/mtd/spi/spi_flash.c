@@ -9,6 +9,8 @@
 #include <malloc.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <watchdog.h>
+#include <zsource.h>
 
 #include "spi_flash_internal.h"
 
@@ -87,6 +89,47 @@ int spi_flash_cmd_write(struct spi_slave *spi, const u8 *cmd, size_t cmd_len,
 }
 
 
+int spi_flash_cmd_wait_ready(struct spi_flash *flash, u8 status_cmd,
+		u8 busy_mask, unsigned long timeout)
+{
+	struct spi_slave *spi = flash->spi;
+	unsigned long timebase;
+	int ret;
+	u8 status;
+
+	/*
+	 * Issue the status command once and keep clocking the register
+	 * out with chip select held, rather than re-sending the opcode
+	 * on every poll.
+	 */
+	ret = spi_xfer(spi, 8, &status_cmd, NULL, SPI_XFER_BEGIN);
+	if (ret) {
+		debug("SF: Failed to send command %02x: %d\n", status_cmd, ret);
+		return ret;
+	}
+
+	timebase = get_timer(0);
+	do {
+		ret = spi_xfer(spi, 8, NULL, &status, 0);
+		if (ret) {
+			spi_xfer(spi, 0, NULL, NULL, SPI_XFER_END);
+			return -1;
+		}
+
+		if ((status & busy_mask) == 0)
+			break;
+
+	} while (get_timer(timebase) < timeout);
+
+	spi_xfer(spi, 0, NULL, NULL, SPI_XFER_END);
+
+	if ((status & busy_mask) == 0)
+		return 0;
+
+	/* Timed out */
+	return -1;
+}
+
 int spi_flash_read_common(struct spi_flash *flash, const u8 *cmd,
 		size_t cmd_len, void *data, size_t data_len)
 {
@@ -189,3 +232,331 @@ void spi_flash_free(struct spi_flash *flash)
 	spi_free_slave(flash->spi);
 	free(flash);
 }
+
+#ifdef CONFIG_ZSOURCE
+static int spi_flash_zsource_read(struct zsource *src, ulong addr,
+		size_t len, void *buf)
+{
+	return spi_flash_read(src->priv, addr, len, buf);
+}
+
+static void spi_flash_zsource_close(struct zsource *src)
+{
+	spi_flash_free(src->priv);
+	src->priv = NULL;
+}
+
+/*
+ * Set up src to stream len bytes of flash starting at offset.  The zsource
+ * takes over flash, which is freed by zsource_end().
+ */
+int spi_flash_zsource(struct spi_flash *flash, u32 offset, u32 len,
+		struct zsource *src)
+{
+	if (offset > flash->size || len > flash->size - offset) {
+		debug("SF: stream 0x%x+0x%x is past the end of flash\n",
+				offset, len);
+		return -1;
+	}
+
+	src->name = flash->name;
+	src->read = spi_flash_zsource_read;
+	src->close = spi_flash_zsource_close;
+	src->priv = flash;
+	src->base = offset;
+	src->len = len;
+
+	return zsource_init(src);
+}
+#endif /* CONFIG_ZSOURCE */
+
+#ifdef CONFIG_SPI_FLASH_STREAM
+#define CMD_WRITE_ENABLE	0x06
+#define CMD_READ_STATUS		0x05
+#define CMD_PAGE_PROGRAM	0x02
+#define CMD_SECTOR_ERASE	0xd8
+#define STATUS_WIP		(1 << 0)
+
+/* Start an erase or program without waiting for it to finish */
+static int sf_stream_cmd(struct spi_flash_stream *s, u8 op, u32 addr,
+		const void *data, size_t len, ulong timeout)
+{
+	struct spi_slave *spi = s->flash->spi;
+	u8 cmd[4];
+	int ret;
+
+	cmd[0] = op;
+	cmd[1] = addr >> 16;
+	cmd[2] = addr >> 8;
+	cmd[3] = addr;
+
+	ret = spi_claim_bus(spi);
+	if (ret) {
+		printf("SF: Unable to claim SPI bus\n");
+		return ret;
+	}
+
+	ret = spi_flash_cmd(spi, CMD_WRITE_ENABLE, NULL, 0);
+	if (!ret)
+		ret = spi_flash_cmd_write(spi, cmd, sizeof(cmd), data, len);
+	spi_release_bus(spi);
+
+	if (ret) {
+		printf("SF: %s at 0x%x failed\n",
+				op == CMD_SECTOR_ERASE ? "erase" : "program",
+				addr);
+		return ret;
+	}
+
+	s->busy = 1;
+	s->op_start = get_timer(0);
+	s->op_timeout = timeout;
+	return 0;
+}
+
+/* 1 while the last erase or program is running, 0 when done, <0 on error */
+static int sf_stream_busy(struct spi_flash_stream *s)
+{
+	struct spi_slave *spi = s->flash->spi;
+	u8 status;
+	int ret;
+
+	if (!s->busy)
+		return 0;
+
+	ret = spi_claim_bus(spi);
+	if (ret)
+		return ret;
+	ret = spi_flash_cmd(spi, CMD_READ_STATUS, &status, 1);
+	spi_release_bus(spi);
+	if (ret)
+		return ret;
+
+	if (!(status & STATUS_WIP)) {
+		s->busy = 0;
+		return 0;
+	}
+
+	if (get_timer(s->op_start) > s->op_timeout) {
+		printf("SF: stream operation timed out\n");
+		return -1;
+	}
+
+	return 1;
+}
+
+/*
+ * Start the next erase or program if the flash is idle.  Partial pages
+ * are only programmed when flushing, and nothing is erased ahead then.
+ *
+ * returns:
+ *     1 if the flash is busy, 0 if there is nothing left to do, <0 on error
+ */
+static int sf_stream_step(struct spi_flash_stream *s, int flush)
+{
+	u32 page_size = s->flash->page_size;
+	size_t buffered = s->pos - s->prog;
+	size_t chunk;
+	const u8 *data;
+	int ret;
+
+	ret = sf_stream_busy(s);
+	if (ret)
+		return ret;
+
+	if (buffered && s->prog == s->erased) {
+		ret = sf_stream_cmd(s, CMD_SECTOR_ERASE, s->erased, NULL, 0,
+				SPI_FLASH_SECTOR_ERASE_TIMEOUT);
+		if (ret)
+			return ret;
+		s->erased += s->flash->sector_size;
+		return 1;
+	}
+
+	chunk = min(buffered, (size_t)(page_size - s->prog % page_size));
+	if (chunk && (flush || (s->prog + chunk) % page_size == 0)) {
+		data = s->ring + s->tail;
+		if (s->tail + chunk > s->ring_size) {
+			size_t n = s->ring_size - s->tail;
+
+			memcpy(s->page, data, n);
+			memcpy(s->page + n, s->ring, chunk - n);
+			data = s->page;
+		}
+
+		ret = sf_stream_cmd(s, CMD_PAGE_PROGRAM, s->prog, data, chunk,
+				SPI_FLASH_PROG_TIMEOUT);
+		if (ret)
+			return ret;
+		s->prog += chunk;
+		s->tail = (s->tail + chunk) % s->ring_size;
+		return 1;
+	}
+
+	/* Waiting for data: erase the next sector before it is needed */
+	if (!flush && s->erased < s->ahead &&
+	    s->erased < s->pos + s->flash->sector_size) {
+		ret = sf_stream_cmd(s, CMD_SECTOR_ERASE, s->erased, NULL, 0,
+				SPI_FLASH_SECTOR_ERASE_TIMEOUT);
+		if (ret)
+			return ret;
+		s->erased += s->flash->sector_size;
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Set up s to program flash from offset on.  offset must start a sector.
+ * If len is not 0 the stream may be no longer than that and sectors up to
+ * offset + len are erased ahead of the data; otherwise only the sectors
+ * the data reaches are erased.
+ */
+int spi_flash_stream_init(struct spi_flash_stream *s, struct spi_flash *flash,
+		u32 offset, u32 len)
+{
+	memset(s, 0, sizeof(*s));
+
+	if (!flash->page_size || !flash->sector_size) {
+		printf("SF: %s does not support streamed writes\n",
+				flash->name);
+		return -1;
+	}
+	if (offset % flash->sector_size) {
+		printf("SF: stream offset 0x%x is not a multiple of the "
+				"sector size 0x%x\n", offset,
+				flash->sector_size);
+		return -1;
+	}
+	if (offset >= flash->size || len > flash->size - offset) {
+		printf("SF: stream 0x%x+0x%x is past the end of flash\n",
+				offset, len);
+		return -1;
+	}
+
+	s->ring_size = max((size_t)CONFIG_SF_STREAM_BUFFER,
+			(size_t)flash->page_size);
+	s->ring = malloc(s->ring_size + flash->page_size);
+	if (!s->ring) {
+		printf("SF: out of memory\n");
+		return -1;
+	}
+	s->page = s->ring + s->ring_size;
+
+	s->flash = flash;
+	s->base = offset;
+	s->end = len ? offset + len : flash->size;
+	s->ahead = len ? offset + len : offset;
+	spi_flash_stream_rewind(s);
+
+	return 0;
+}
+
+/*
+ * Append len bytes, which must follow on from the previous call (offset
+ * is relative to the start of the stream).  Only waits for the flash if
+ * the buffer is full.
+ */
+int spi_flash_stream_write(struct spi_flash_stream *s, u32 offset,
+		const void *buf, size_t len)
+{
+	const u8 *src = buf;
+	size_t buffered, head, n;
+	int ret;
+
+	if (offset != s->pos - s->base) {
+		printf("SF: stream data at 0x%x, expected 0x%x\n",
+				offset, s->pos - s->base);
+		return -1;
+	}
+	if (len > s->end - s->pos) {
+		printf("SF: stream is longer than 0x%x bytes\n",
+				s->end - s->base);
+		return -1;
+	}
+
+	while (len) {
+		buffered = s->pos - s->prog;
+		if (buffered == s->ring_size) {
+			WATCHDOG_RESET();
+			ret = sf_stream_step(s, 0);
+			if (ret < 0)
+				return ret;
+			continue;
+		}
+
+		head = (s->tail + buffered) % s->ring_size;
+		n = min(len, s->ring_size - buffered);
+		n = min(n, s->ring_size - head);
+		memcpy(s->ring + head, src, n);
+		s->pos += n;
+		src += n;
+		len -= n;
+	}
+
+	ret = sf_stream_step(s, 0);
+	return ret < 0 ? ret : 0;
+}
+
+/* Wait until at least len bytes (at most the buffer size) can be added */
+int spi_flash_stream_reserve(struct spi_flash_stream *s, size_t len)
+{
+	int ret;
+
+	len = min(len, s->ring_size);
+	do {
+		WATCHDOG_RESET();
+		ret = sf_stream_step(s, 0);
+		if (ret < 0)
+			return ret;
+	} while (s->ring_size - (s->pos - s->prog) < len);
+
+	return 0;
+}
+
+/* Program everything buffered and wait for the flash */
+int spi_flash_stream_finish(struct spi_flash_stream *s)
+{
+	int ret;
+
+	do {
+		WATCHDOG_RESET();
+		ret = sf_stream_step(s, 1);
+	} while (ret > 0);
+
+	if (ret == 0)
+		printf("SF: %u bytes programmed at 0x%x\n",
+				s->pos - s->base, s->base);
+	return ret;
+}
+
+/*
+ * Start again from the beginning, e.g. when a transfer is restarted.
+ * Sectors are erased again as they are reached.
+ */
+void spi_flash_stream_rewind(struct spi_flash_stream *s)
+{
+	while (sf_stream_busy(s) > 0)
+		WATCHDOG_RESET();
+	s->busy = 0;
+
+	s->pos = s->prog = s->erased = s->base;
+	s->tail = 0;
+}
+
+/*
+ * Release the buffer.  After ctrl-C or a failed transfer an erase or
+ * program may still be running; wait for it, so the chip is idle for
+ * whatever uses the flash next.
+ */
+void spi_flash_stream_end(struct spi_flash_stream *s)
+{
+	while (sf_stream_busy(s) > 0)
+		WATCHDOG_RESET();
+	s->busy = 0;
+
+	free(s->ring);
+	s->ring = NULL;
+}
+#endif /* CONFIG_SPI_FLASH_STREAM */
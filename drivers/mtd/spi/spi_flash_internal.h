@@ -43,6 +43,14 @@ int spi_flash_cmd_write(struct spi_slave *spi, const u8 *cmd, size_t cmd_len,
 int spi_flash_read_common(struct spi_flash *flash, const u8 *cmd,
 		size_t cmd_len, void *data, size_t data_len);
 
+/*
+ * Poll the device status register with status_cmd until all bits in
+ * busy_mask read back as zero, or until timeout (in ms) expires. The
+ * caller must have claimed the bus.
+ */
+int spi_flash_cmd_wait_ready(struct spi_flash *flash, u8 status_cmd,
+		u8 busy_mask, unsigned long timeout);
+
 /* Manufacturer-specific probe functions */
 struct spi_flash *spi_flash_probe_spansion(struct spi_slave *spi, u8 *idcode);
 struct spi_flash *spi_flash_probe_atmel(struct spi_slave *spi, u8 *idcode);
@@ -363,6 +363,9 @@ spi_flash_probe_sst(struct spi_slave *spi, u8 *idcode)
 	stm->flash.erase = sst_erase;
 	stm->flash.read = sst_read_fast;
 	stm->flash.size = SST_SECTOR_SIZE * params->nr_sectors;
+	/* Programmed a byte or word at a time, no stream support */
+	stm->flash.page_size = 0;
+	stm->flash.sector_size = 0;
 
 	debug("SF: Detected %s with page size %u, total %u bytes\n",
 	      params->name, SST_SECTOR_SIZE, stm->flash.size);
@@ -154,36 +154,8 @@ static const struct stmicro_spi_flash_params stmicro_spi_flash_table[] = {
 
 static int stmicro_wait_ready(struct spi_flash *flash, unsigned long timeout)
 {
-	struct spi_slave *spi = flash->spi;
-	unsigned long timebase;
-	int ret;
-	u8 cmd = CMD_M25PXX_RDSR;
-	u8 status;
-
-	ret = spi_xfer(spi, 8, &cmd, NULL, SPI_XFER_BEGIN);
-	if (ret) {
-		debug("SF: Failed to send command %02x: %d\n", cmd, ret);
-		return ret;
-	}
-
-	timebase = get_timer(0);
-	do {
-		ret = spi_xfer(spi, 8, NULL, &status, 0);
-		if (ret)
-			return -1;
-
-		if ((status & STMICRO_SR_WIP) == 0)
-			break;
-
-	} while (get_timer(timebase) < timeout);
-
-	spi_xfer(spi, 0, NULL, NULL, SPI_XFER_END);
-
-	if ((status & STMICRO_SR_WIP) == 0)
-		return 0;
-
-	/* Timed out */
-	return -1;
+	return spi_flash_cmd_wait_ready(flash, CMD_M25PXX_RDSR,
+					STMICRO_SR_WIP, timeout);
 }
 
 static int stmicro_read_fast(struct spi_flash *flash,
@@ -228,6 +200,12 @@ static int stmicro_write(struct spi_flash *flash,
 		return ret;
 	}
 
+	/*
+	 * Each page is staged (command built, chunk located) before waiting
+	 * for the previous page program to complete, so the only time spent
+	 * between pages is the status poll itself.  The final page is waited
+	 * on once the loop has issued everything.
+	 */
 	ret = 0;
 	for (actual = 0; actual < len; actual += chunk_len) {
 		chunk_len = min(len - actual, page_size - byte_addr);
@@ -241,6 +219,14 @@ static int stmicro_write(struct spi_flash *flash,
 		    ("PP: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x } chunk_len = %d\n",
 		     buf + actual, cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
 
+		if (actual) {
+			ret = stmicro_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+			if (ret < 0) {
+				debug("SF: STMicro page programming timed out\n");
+				break;
+			}
+		}
+
 		ret = spi_flash_cmd(flash->spi, CMD_M25PXX_WREN, NULL, 0);
 		if (ret < 0) {
 			debug("SF: Enabling Write failed\n");
@@ -254,16 +240,16 @@ static int stmicro_write(struct spi_flash *flash,
 			break;
 		}
 
-		ret = stmicro_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
-		if (ret < 0) {
-			debug("SF: STMicro page programming timed out\n");
-			break;
-		}
-
 		page_addr++;
 		byte_addr = 0;
 	}
 
+	if (ret == 0 && len) {
+		ret = stmicro_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+		if (ret < 0)
+			debug("SF: STMicro page programming timed out\n");
+	}
+
 	debug("SF: STMicro: Successfully programmed %u bytes @ 0x%x\n",
 	      len, offset);
 
@@ -383,6 +369,8 @@ struct spi_flash *spi_flash_probe_stmicro(struct spi_slave *spi, u8 * idcode)
 	stm->flash.read = stmicro_read_fast;
 	stm->flash.size = params->page_size * params->pages_per_sector
 	    * params->nr_sectors;
+	stm->flash.page_size = params->page_size;
+	stm->flash.sector_size = params->page_size * params->pages_per_sector;
 
 	debug("SF: Detected %s with page size %u, total %u bytes\n",
 	      params->name, params->page_size, stm->flash.size);
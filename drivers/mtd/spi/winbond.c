@@ -324,6 +324,9 @@ struct spi_flash *spi_flash_probe_winbond(struct spi_slave *spi, u8 *idcode)
 	stm->flash.size = page_size * params->pages_per_sector
 				* params->sectors_per_block
 				* params->nr_blocks;
+	stm->flash.page_size = page_size;
+	stm->flash.sector_size = page_size * params->pages_per_sector
+				* params->sectors_per_block;
 
 	debug("SF: Detected %s with page size %u, total %u bytes\n",
 			params->name, page_size, stm->flash.size);
@@ -70,6 +70,13 @@
 #define RX_CHNL_STS		(LABX_ETH_LOCALLINK_SDMA_CTRL_BASEADDR + 0x3c)
 
 #define DMA_CONTROL_REG		(LABX_ETH_LOCALLINK_SDMA_CTRL_BASEADDR + 0x40)
+
+/* Channel status register bits */
+#define CHNL_STS_ERROR		0x00000080
+
+/* DMA control register bits */
+#define DMA_CONTROL_RESET	0x00000001
+#define DMA_TAIL_ENABLE		0x00000004
 #endif
 
 /* 
@@ -220,8 +227,16 @@ typedef struct cdmac_bd_t {
   unsigned long app5;
 } cdmac_bd __attribute((aligned(32))) ;
 
-static cdmac_bd	tx_bd;
-static cdmac_bd	rx_bd;
+/* Ring sizes; every Rx descriptor owns one of the net core's receive buffers */
+#define RX_BD_COUNT	PKTBUFSRX
+#ifdef CONFIG_SYS_TX_ETH_BUFFER
+#  define TX_BD_COUNT	CONFIG_SYS_TX_ETH_BUFFER
+#else
+#  define TX_BD_COUNT	4
+#endif
+
+/* Time to wait for a Tx descriptor to come free, in msec */
+#define TX_TIMEOUT	100
 
 #endif
 
@@ -404,150 +419,247 @@ static int labx_eth_phy_ctrl(void)
   return 1;
 }
 
-/* Rx buffer is also used by FIFO mode */
-static unsigned char rx_buffer[ETHER_MTU] __attribute((aligned(32)));
-
 #ifdef LABX_ETH_LOCALLINK_SDMA_MODE
-static unsigned char tx_buffer[ETHER_MTU] __attribute((aligned(32)));
+/* Interval between checks of the PHY link status while sending, in msec */
+#define LINK_CHECK_INTERVAL  1000
 
-/* bd init */
-static void labx_eth_bd_init()
-{
-  memset((void *)&tx_bd, 0, sizeof(cdmac_bd));
-  memset((void *)&rx_bd, 0, sizeof(cdmac_bd));
-
-  rx_bd.phys_buf_p = &rx_buffer[0];
-  rx_bd.next_p = &rx_bd;
-  rx_bd.buf_len = ETHER_MTU;
-  invalidate_dcache_range(&rx_bd, sizeof(cdmac_bd));
+static ulong link_checked;
 
+/* Returns the cached link state.  Transmit calls this for every frame, so
+ * the PHY is only consulted once per LINK_CHECK_INTERVAL, with a single MDIO
+ * read of its status register; the full labx_eth_phy_ctrl() (which also sets
+ * the MAC speed) runs only when the link has just come up.  Nothing here
+ * waits for a link to appear.
+ */
+static int labx_eth_link_up(void)
+{
+  unsigned int result;
 
-  *(unsigned int *)RX_CURDESC_PTR = &rx_bd;
-  *(unsigned int *)RX_TAILDESC_PTR = &rx_bd;
+  if(get_timer(link_checked) < LINK_CHECK_INTERVAL)
+    return link;
+  link_checked = get_timer(0);
 
-  *(unsigned int *)RX_NXTDESC_PTR = &rx_bd; // setup first fd
+  result = read_phy_register(phy_addr, 1);
+  if((result & 0x24) != 0x24) {
+    if(link) {
+      link = 0;
+      printf("Link has gone down\n");
+    }
+    return 0;
+  }
 
+  if(!link)
+    return labx_eth_phy_ctrl();
 
-  tx_bd.phys_buf_p = &tx_buffer[0];
-  tx_bd.next_p = &tx_bd;
-  invalidate_dcache_range(&tx_bd, sizeof(cdmac_bd));
-  *(unsigned int *)TX_CURDESC_PTR = &tx_bd;
+  return 1;
 }
 #endif
 
-#ifdef LABX_ETH_LOCALLINK_SDMA_MODE
-static int labx_eth_send_sdma(unsigned char *buffer, int length)
-{
-  int i;
+#ifdef LABX_ETH_LOCALLINK_FIFO_MODE
+static unsigned char rx_buffer[ETHER_MTU] __attribute((aligned(32)));
+#endif
 
-  if(labx_eth_phy_ctrl() == 0)
-    return 0;
+#ifdef LABX_ETH_LOCALLINK_SDMA_MODE
 
-  memcpy(tx_buffer, buffer, length);
-  invalidate_dcache_range(tx_buffer, length);
+/* Descriptor rings.  Receive buffers are the net core's NetRxPackets[], which
+ * are PKTALIGN aligned and PKTSIZE_ALIGN long, so no two buffers (or a buffer
+ * and a descriptor) ever share a cache line.
+ */
+static cdmac_bd rx_ring[RX_BD_COUNT];
+static cdmac_bd tx_ring[TX_BD_COUNT];
+static unsigned char tx_buffer[TX_BD_COUNT][PKTSIZE_ALIGN] __attribute((aligned(32)));
 
-  tx_bd.stat = BDSTAT_SOP_MASK | BDSTAT_EOP_MASK | BDSTAT_STOP_ON_END_MASK;
-  tx_bd.buf_len = length;
-  invalidate_dcache_range(&tx_bd, sizeof(cdmac_bd));
+static int rx_head;    /* Next Rx descriptor the DMA will complete */
+static int tx_head;    /* Next free Tx descriptor */
+static int tx_tail;    /* Oldest Tx descriptor not yet reclaimed */
+static int tx_count;   /* Tx descriptors handed to the DMA */
+static unsigned int ring_generation; /* Bumped each time the rings are rebuilt */
 
-  // Wait for DMA to complete if one is active
-  while (*(volatile unsigned int*)(TX_CHNL_STS) & 0x00000002);
+static void bd_flush(cdmac_bd *bd)
+{
+  flush_dcache_range((ulong)bd, (ulong)bd + sizeof(cdmac_bd));
+}
 
-  *(volatile unsigned int *)TX_CURDESC_PTR = &tx_bd;
-  *(volatile unsigned int *)TX_TAILDESC_PTR = &tx_bd;	// DMA start
+static void bd_invalidate(cdmac_bd *bd)
+{
+  invalidate_dcache_range((ulong)bd, (ulong)bd + sizeof(cdmac_bd));
+}
 
-  do {
-    invalidate_dcache_range(&tx_bd, sizeof(cdmac_bd));
+/* Hands an Rx descriptor (back) to the DMA engine.  The buffer is invalidated
+ * first so that no dirty line of it can be evicted on top of received data.
+ */
+static void labx_eth_rx_arm(cdmac_bd *bd)
+{
+  invalidate_dcache_range((ulong)bd->phys_buf_p,
+                          (ulong)bd->phys_buf_p + ETHER_MTU);
+  bd->buf_len = ETHER_MTU;
+  bd->stat = 0;
+  bd->app5 = 0;
+  bd_flush(bd);
+}
 
-    if ((*(volatile unsigned int*)(TX_CHNL_STS)) & 0x00000080)
-      {
-	printf("TX DMA Error\n");
-	for (i=0; i<0x44; i+=4)
-	  {
-	    printf("SDMA REG %08X: %08x\n", (TX_NXTDESC_PTR+i),
-		   *(volatile unsigned int*)(TX_NXTDESC_PTR+i));
-	  }
+/* Resets the SDMA engine and (re)builds both descriptor rings.  The Rx ring is
+ * handed to the DMA in its entirety; the Tx ring starts out empty.
+ */
+static void labx_eth_bd_init(void)
+{
+  int i;
 
-	// Reset and reinitialize the DMA engine
-	*(volatile unsigned int*)(DMA_CONTROL_REG) = 0x00000001;
-	while (*(volatile unsigned int*)(DMA_CONTROL_REG) & 0x00000001);
+  *(volatile unsigned int *)DMA_CONTROL_REG = DMA_CONTROL_RESET;
+  while(*(volatile unsigned int *)DMA_CONTROL_REG & DMA_CONTROL_RESET);
+  *(volatile unsigned int *)DMA_CONTROL_REG = DMA_TAIL_ENABLE;
 
-	labx_eth_bd_init();
-	break;
-      }
+  memset((void *)rx_ring, 0, sizeof(rx_ring));
+  for(i = 0; i < RX_BD_COUNT; i++) {
+    rx_ring[i].next_p = &rx_ring[(i + 1) % RX_BD_COUNT];
+    rx_ring[i].phys_buf_p = (unsigned char *)NetRxPackets[i];
+    labx_eth_rx_arm(&rx_ring[i]);
+  }
+  rx_head = 0;
 
-    if (((*(volatile unsigned int*)(TX_CHNL_STS)) & 0x00000002) == 0)
-      {
-	invalidate_dcache_range(&tx_bd, sizeof(cdmac_bd));
-	//			printf("Exit loop %08X\n", (volatile int)tx_bd.stat);
-	break;
-      }
-  } while(!(((volatile unsigned int)tx_bd.stat) & BDSTAT_COMPLETED_MASK));
+  memset((void *)tx_ring, 0, sizeof(tx_ring));
+  for(i = 0; i < TX_BD_COUNT; i++) {
+    tx_ring[i].next_p = &tx_ring[(i + 1) % TX_BD_COUNT];
+    tx_ring[i].phys_buf_p = &tx_buffer[i][0];
+  }
+  flush_dcache_range((ulong)tx_ring, (ulong)tx_ring + sizeof(tx_ring));
+  tx_head = tx_tail = tx_count = 0;
 
-  return length;
+  *(volatile unsigned int *)RX_CURDESC_PTR = (unsigned int)&rx_ring[0];
+  *(volatile unsigned int *)RX_TAILDESC_PTR = (unsigned int)&rx_ring[RX_BD_COUNT - 1];
+  *(volatile unsigned int *)TX_CURDESC_PTR = (unsigned int)&tx_ring[0];
+  ring_generation++;
 }
 
-
-static int labx_eth_recv_sdma()
+/* Reports an SDMA error and restarts the engine from scratch */
+static void labx_eth_sdma_error(const char *which)
 {
-  int length;
   int i;
 
-  invalidate_dcache_range(&rx_bd, sizeof(cdmac_bd));
-
-  if ((*(volatile unsigned int*)(RX_CHNL_STS)) & 0x00000080)
+  printf("%s DMA Error\n", which);
+  for (i=0; i<0x44; i+=4)
     {
-      printf("RX DMA Error\n");
-      for (i=0; i<0x44; i+=4)
-	{
-	  printf("SDMA REG %08X: %08x\n", (TX_NXTDESC_PTR+i),
-		 *(volatile unsigned int*)(TX_NXTDESC_PTR+i));
-	}
+      printf("SDMA REG %08X: %08x\n", (TX_NXTDESC_PTR+i),
+             *(volatile unsigned int*)(TX_NXTDESC_PTR+i));
+    }
 
-      // Reset and reinitialize the DMA engine
-      *(volatile unsigned int*)(DMA_CONTROL_REG) = 0x00000001;
-      while (*(volatile unsigned int*)(DMA_CONTROL_REG) & 0x00000001);
+  labx_eth_bd_init();
+}
+
+/* Reclaims Tx descriptors the DMA has finished with.  Nothing waits for a
+ * transmission to complete; this is only done when a descriptor is needed.
+ */
+static void labx_eth_tx_reclaim(void)
+{
+  cdmac_bd *bd;
 
+  while(tx_count > 0) {
+    bd = &tx_ring[tx_tail];
+    bd_invalidate(bd);
+    if(!(bd->stat & BDSTAT_COMPLETED_MASK)) break;
+
+    bd->stat = 0;
+    bd_flush(bd);
+    tx_tail = (tx_tail + 1) % TX_BD_COUNT;
+    tx_count--;
+  }
+}
+
+/* Waits, up to a time limit, until no more than count Tx descriptors are
+ * still in flight.
+ */
+static int labx_eth_tx_drain(int count)
+{
+  ulong start = get_timer(0);
+
+  for(;;) {
+    if ((*(volatile unsigned int*)(TX_CHNL_STS)) & CHNL_STS_ERROR) {
+      labx_eth_sdma_error("TX");
+      return -1;
+    }
+
+    labx_eth_tx_reclaim();
+    if(tx_count <= count) return 0;
+
+    if(get_timer(start) > TX_TIMEOUT) {
+      printf("TX DMA timeout\n");
       labx_eth_bd_init();
+      return -1;
     }
-	
-  //	if(!((volatile unsigned int)rx_bd.stat & BDSTAT_COMPLETED_MASK)) {
-  if (((*(volatile unsigned int*)(RX_CHNL_STS)) & 0x00000010) == 0) {
-    return 0;
   }
+}
 
-  invalidate_dcache_range(&rx_bd, sizeof(cdmac_bd));
+static int labx_eth_send_sdma(unsigned char *buffer, int length)
+{
+  cdmac_bd *bd;
+
+  if(!labx_eth_link_up())
+    return 0;
 
-  //	printf("RX CH STS: %08x, %08x, %08x, %08x, %08x\n", *(volatile unsigned int*)(RX_CHNL_STS), (int)rx_bd.stat, rx_bd.app2, rx_bd.app3, rx_bd.app4);
+  /* Make room in the ring if every descriptor is in flight */
+  if(tx_count == TX_BD_COUNT && labx_eth_tx_drain(TX_BD_COUNT - 1))
+    return 0;
 
-  length = rx_bd.app5;
-  invalidate_dcache_range(rx_bd.phys_buf_p, length);
+  /* The frame is copied into the descriptor's own buffer, so the caller can
+   * build its next frame (the net core reuses NetTxPacket for every one)
+   * while this one is still in flight.  Only the lines it covers are
+   * flushed.
+   */
+  bd = &tx_ring[tx_head];
+  memcpy(bd->phys_buf_p, buffer, length);
+  flush_dcache_range((ulong)bd->phys_buf_p, (ulong)bd->phys_buf_p + length);
 
-  //	*(volatile unsigned int*)&rx_bd.next_p = &rx_bd;
-  *(volatile unsigned int*)&rx_bd.buf_len = ETHER_MTU;
-  *(volatile unsigned int*)&rx_bd.stat = 0;
-  *(volatile unsigned int*)&rx_bd.app5 = 0;
+  bd->stat = BDSTAT_SOP_MASK | BDSTAT_EOP_MASK;
+  bd->buf_len = length;
+  bd_flush(bd);
 
-  invalidate_dcache_range(&rx_bd, sizeof(cdmac_bd));
-#if 0	
-  if (length == 0) length = 1500;
-  printf("recv_sdma (%d)", length);
-  for (i = 0; i<length; i++)
+  /* Moving the tail pointer on starts (or extends) the DMA */
+  *(volatile unsigned int *)TX_TAILDESC_PTR = (unsigned int)bd;
+  tx_head = (tx_head + 1) % TX_BD_COUNT;
+  tx_count++;
+
+  return length;
+}
+
+/* Passes every frame the DMA has completed to the net core, handing each
+ * descriptor back as soon as NetReceive() is done with its buffer.
+ */
+static int labx_eth_recv_sdma(void)
+{
+  cdmac_bd *bd;
+  int length;
+  int frames;
+  unsigned int generation = ring_generation;
+
+  if ((*(volatile unsigned int*)(RX_CHNL_STS)) & CHNL_STS_ERROR)
     {
-      if (i%8 == 0) printf("\n");
-      printf("%02X ", rx_bd.phys_buf_p[i]);
+      labx_eth_sdma_error("RX");
+      return 0;
     }
-  printf("\n");
-#endif
-  if(length > 0) {
-    NetReceive(rx_bd.phys_buf_p, length);
-  }
 
-  *(volatile unsigned int *)RX_CURDESC_PTR = &rx_bd;
-  *(volatile unsigned int *)RX_TAILDESC_PTR = &rx_bd;
-  *(volatile unsigned int *)RX_NXTDESC_PTR = &rx_bd;
+  for(frames = 0; frames < RX_BD_COUNT; frames++) {
+    bd = &rx_ring[rx_head];
+    bd_invalidate(bd);
+    if(!(bd->stat & BDSTAT_COMPLETED_MASK)) break;
 
-  return length;
+    length = bd->app5;
+    invalidate_dcache_range((ulong)bd->phys_buf_p,
+                            (ulong)bd->phys_buf_p + length);
+    if(length > 0) {
+      NetReceive(bd->phys_buf_p, length);
+    }
+
+    /* NetReceive() may have restarted the transfer (NetStartAgain()), which
+     * re-inits the device and rebuilds the rings; bd is no longer ours then.
+     */
+    if(ring_generation != generation) return frames + 1;
+
+    labx_eth_rx_arm(bd);
+    *(volatile unsigned int *)RX_TAILDESC_PTR = (unsigned int)bd;
+    rx_head = (rx_head + 1) % RX_BD_COUNT;
+  }
+
+  return frames;
 }
 #endif
 
@@ -709,8 +821,10 @@ static int labx_eth_init(struct eth_device *dev, bd_t *bis)
   //	printf ("fifo isr 0x%08x, fifo_ier 0x%08x, fifo_tdfv 0x%08x, fifo_rdfo 0x%08x fifo_rlf 0x%08x\n", ll_fifo->isr, ll_fifo->ier, ll_fifo->tdfv, ll_fifo->rdfo,ll_fifo->rlf);
 #endif
 
+#ifdef LABX_ETH_LOCALLINK_FIFO_MODE
   /* Issue a LocalLink reset to make sure nothing is "stuck" */
   ll_fifo->llr = FIFO_RESET_MAGIC;
+#endif
 
   /* Configure the MDIO divisor and enable the interface to the PHY.
    * XILINX_HARD_MAC Note: The hard MDIO controller must be configured or
@@ -731,6 +845,9 @@ static int labx_eth_init(struct eth_device *dev, bd_t *bis)
 
   /* Configure the PHY */
   labx_eth_phy_ctrl();
+#ifdef LABX_ETH_LOCALLINK_SDMA_MODE
+  link_checked = get_timer(0);
+#endif
   first = 0;
 
   return(0);
@@ -738,12 +855,17 @@ static int labx_eth_init(struct eth_device *dev, bd_t *bis)
 
 static void labx_eth_halt(struct eth_device *dev)
 {
+#ifdef LABX_ETH_LOCALLINK_SDMA_MODE
+  /* Let queued frames (such as a final TFTP ACK) go out first */
+  if(tx_count > 0) labx_eth_tx_drain(0);
+#endif
+
   labx_eth_write_mac_reg(MAC_RX_CONFIG_REG, RX_DISABLE);
   labx_eth_write_mac_reg(MAC_TX_CONFIG_REG, TX_DISABLE);
 
 #ifdef LABX_ETH_LOCALLINK_SDMA_MODE
-  *(unsigned int *)DMA_CONTROL_REG = 0x00000001;
-  while(*(volatile unsigned int *)DMA_CONTROL_REG & 1);
+  *(volatile unsigned int *)DMA_CONTROL_REG = DMA_CONTROL_RESET;
+  while(*(volatile unsigned int *)DMA_CONTROL_REG & DMA_CONTROL_RESET);
 #endif
 }
 
@@ -751,10 +751,41 @@ static int labx_eth_phy_ctrl(void)
   return rc;
 }
 
-/* Rx buffer is also used by FIFO mode */
-static unsigned char rx_buffer[ETHER_MTU] __attribute((aligned(32)));
+/* Interval between checks of the PHY link status while sending, in msec */
+#define LINK_CHECK_INTERVAL  1000
 
+static ulong link_checked;
 
+/* Returns the cached link state, re-reading the PHY status register at most
+ * once per LINK_CHECK_INTERVAL.  labx_eth_phy_ctrl(), with its wait for a
+ * link and the MAC speed setup, is only run once the link is back up.
+ */
+static int labx_eth_link_up(void)
+{
+  if(get_timer(link_checked) < LINK_CHECK_INTERVAL)
+    return link;
+  link_checked = get_timer(0);
+
+  if((read_phy_register(phy_addr, MII_STAT) & PHY_STAT_LINK_UP) == 0) {
+    if(link) {
+      link = 0;
+      printf("Link has gone down\n");
+    }
+    return 0;
+  }
+
+  if(!link)
+    return labx_eth_phy_ctrl();
+
+  return 1;
+}
+
+/* Received frames are copied out of the FIFO into the net core's receive
+ * buffers in turn.  rx_backlog records that a poll stopped short with frames
+ * still in the FIFO, whose arrival has already been acknowledged.
+ */
+static int rx_next = 0;
+static int rx_backlog = 0;
 
 void debugll(int count)
 {
@@ -780,32 +811,76 @@ static int labx_eth_send_fifo(unsigned char *buffer, int length)
   return length;
 }
 
-static int labx_eth_recv_fifo(void)
+/* Reads a frame of len bytes out of the Rx data FIFO into buf, which must
+ * be word aligned.
+ */
+static void labx_eth_read_fifo(u32 *buf, int len)
 {
-  int len, len2, i, val;
-  int *buf = (int*) &rx_buffer[0];
+  volatile int *rdfd = &ll_fifo->rdfd;
+  int words = ((len + 3) / 4);
 
-  if (ll_fifo->isr & FIFO_ISR_RC) {
-    /* One or more packets have been received.  Check the read occupancy register
-     * to see how much data is ready to be processed.
-     */
-    len = ll_fifo->rlf & RLF_MASK;
-    len2 = ((len + 3) / 4);
+  /* Issue the FIFO reads in bursts of four ahead of the stores */
+  while (words >= 4) {
+    u32 w0 = *rdfd, w1 = *rdfd, w2 = *rdfd, w3 = *rdfd;
 
-    for (i = 0; i < len2; i++) {
-      val = ll_fifo->rdfd;
-      *buf++ = val ;
-    }
+    buf[0] = w0; buf[1] = w1; buf[2] = w2; buf[3] = w3;
+    buf += 4;
+    words -= 4;
+  }
+  while (words--) *buf++ = *rdfd;
+}
+
+/* Reads a frame of len bytes out of the Rx data FIFO and discards it */
+static void labx_eth_drop_fifo(int len)
+{
+  volatile int *rdfd = &ll_fifo->rdfd;
+  int words = ((len + 3) / 4);
 
-    /* Re-check the occupancy register; if there are still FIFO contents
-     * remaining, they are for valid packets.  Not sure if it's okay to call
-     * NetReceive() more than once for each invocation, so we'll just leave
-     * the ISR flag set instead and let the NetLoop invoke us again.
+  while (words--) (void) *rdfd;
+}
+
+static int labx_eth_recv_fifo(void)
+{
+  uchar *buf;
+  int len;
+  int frames = 0;
+
+  if (rx_backlog || (ll_fifo->isr & FIFO_ISR_RC)) {
+    /* One or more packets have been received.  Acknowledge the flag before
+     * draining the FIFO, so that a frame completing while we do raises it
+     * again rather than being left behind until the next one arrives.
      */
-    if(ll_fifo->rdfo == 0) ll_fifo->isr = FIFO_ISR_RC;
+    ll_fifo->isr = FIFO_ISR_RC;
+    rx_backlog = 0;
+
+    /* Deliver every complete frame the FIFO holds, stopping early only if
+     * a protocol handler has ended the network loop, or after a full pass
+     * of the receive buffers so that a flood cannot starve the NetLoop's
+     * timeout and ctrl-C checks.  Any frames left behind are picked up on
+     * the next poll.
+     */
+    while (ll_fifo->rdfo != 0) {
+      len = ll_fifo->rlf & RLF_MASK;
+
+      /* A frame longer than a receive buffer would run into the next one */
+      if (len > PKTSIZE_ALIGN) {
+        labx_eth_drop_fifo(len);
+      } else {
+        buf = (uchar *) NetRxPackets[rx_next];
+        rx_next = ((rx_next + 1) % PKTBUFSRX);
+
+        labx_eth_read_fifo((u32 *) buf, len);
+
+        /* Enqueue the received packet! */
+        NetReceive(buf, len);
+      }
+      frames++;
 
-    /* Enqueue the received packet! */
-    NetReceive (&rx_buffer[0], len);
+      if ((NetState != NETLOOP_CONTINUE) || (frames == PKTBUFSRX)) {
+        rx_backlog = (ll_fifo->rdfo != 0);
+        break;
+      }
+    }
   } else if(ll_fifo->isr & FIFO_ISR_RX_ERR) {
     printf("Rx error 0x%08X\n", ll_fifo->isr);
 
@@ -814,7 +889,7 @@ static int labx_eth_recv_fifo(void)
     ll_fifo->rdfr = FIFO_RESET_MAGIC;
   }
 
-    return 0;
+  return frames;
 }
 
 /* FOO */
@@ -992,11 +1067,81 @@ static void configure_mac_filter(int unitNum, const u8 mac[6], int mode) {
   select_matchers(SELECT_NONE, 0);
 }
 
+/* Match unit assignments.  The unicast unit is always loaded; the broadcast
+ * unit is switched on and off as the net core needs it, and any units beyond
+ * those take multicast groups.
+ */
+#define MATCH_UNIT_UNICAST    0
+#define MATCH_UNIT_BROADCAST  1
+#define MATCH_UNIT_MCAST_BASE 2
+#define MAX_MCAST_GROUPS      8
+
+static uint32_t numMacFilters = 0;
+static int bcastEnabled = -1;
+
+/* Enables or disables the broadcast match unit, if that is a change */
+static void labx_eth_set_bcast(int enable)
+{
+  if((numMacFilters <= MATCH_UNIT_BROADCAST) || (enable == bcastEnabled))
+    return;
+
+  configure_mac_filter(MATCH_UNIT_BROADCAST, MAC_BROADCAST,
+                       (enable ? MAC_MATCH_ALL : MAC_MATCH_NONE));
+  bcastEnabled = enable;
+}
+
+#ifdef CONFIG_NET_RX_FILTER
+/* Applies the net core's receive needs to the match units */
+static void labx_eth_rx_filter(struct eth_device *dev, int flags)
+{
+  labx_eth_set_bcast((flags & NET_RX_BCAST) != 0);
+}
+#endif
+
+#ifdef CONFIG_MCAST_TFTP
+static u8 mcastGroups[MAX_MCAST_GROUPS][6];
+static int mcastUsed[MAX_MCAST_GROUPS];
+
+/* Joins or leaves a multicast group by loading or clearing a match unit */
+static int labx_eth_mcast(struct eth_device *dev, const u8 *enetaddr, u8 set)
+{
+  int numGroups = 0;
+  int freeSlot = -1;
+  int i;
+
+  if(numMacFilters > MATCH_UNIT_MCAST_BASE)
+    numGroups = min((int)(numMacFilters - MATCH_UNIT_MCAST_BASE), MAX_MCAST_GROUPS);
+
+  for(i = 0; i < numGroups; i++) {
+    if(!mcastUsed[i]) {
+      if(freeSlot < 0) freeSlot = i;
+    } else if(memcmp(mcastGroups[i], enetaddr, 6) == 0) {
+      if(!set) {
+        configure_mac_filter((MATCH_UNIT_MCAST_BASE + i), MAC_ZERO, MAC_MATCH_NONE);
+        mcastUsed[i] = 0;
+      }
+      return(0);
+    }
+  }
+
+  if(!set) return(0);
+
+  if(freeSlot < 0) {
+    printf("labx_ethernet : no MAC filter free for %pM\n", enetaddr);
+    return(-1);
+  }
+
+  memcpy(mcastGroups[freeSlot], enetaddr, 6);
+  mcastUsed[freeSlot] = 1;
+  configure_mac_filter((MATCH_UNIT_MCAST_BASE + freeSlot), enetaddr, MAC_MATCH_ALL);
+  return(0);
+}
+#endif
+
 /* setup mac addr */
 static int labx_eth_addr_setup(struct labx_eth_private * lp)
 {
   unsigned int addr;
-  uint32_t numMacFilters;
   char * env_p;
   char * end;
   int i;
@@ -1023,13 +1168,12 @@ static int labx_eth_addr_setup(struct labx_eth_private * lp)
   /* Configure for our unicast MAC address first, and the broadcast MAC
    * address second, provided there are enough MAC address filters.
    */
-  if(numMacFilters >= 1) {
-    configure_mac_filter(0, lp->dev_addr, MAC_MATCH_ALL);
+  if(numMacFilters > MATCH_UNIT_UNICAST) {
+    configure_mac_filter(MATCH_UNIT_UNICAST, lp->dev_addr, MAC_MATCH_ALL);
   }
 
-  if(numMacFilters >= 2) {
-    configure_mac_filter(1, MAC_BROADCAST, MAC_MATCH_ALL);
-  }
+  bcastEnabled = -1;
+  labx_eth_set_bcast(1);
   
   return(0);
 }
@@ -1052,6 +1196,10 @@ static int labx_eth_init(struct eth_device *dev, bd_t *bis)
      */
     labx_eth_restart();
     labx_eth_phy_ctrl();
+    link_checked = get_timer(0);
+
+    /* Accept broadcasts again until the net core says otherwise */
+    labx_eth_set_bcast(1);
     return(0);
   }
 
@@ -1080,6 +1228,7 @@ static int labx_eth_init(struct eth_device *dev, bd_t *bis)
 
   /* Configure the PHY */
   labx_eth_phy_ctrl();
+  link_checked = get_timer(0);
   first = 0;
 
   return(0);
@@ -1093,9 +1242,8 @@ static void labx_eth_halt(struct eth_device *dev)
 
 int labx_eth_send(struct eth_device *dev, volatile void *packet, int length)
 {
-  if(!link)
-    if(labx_eth_phy_ctrl() == 0)
-      return 0;
+  if(!labx_eth_link_up())
+    return 0;
 
   return(labx_eth_send_fifo((unsigned char *)packet, length));
 }
@@ -1123,6 +1271,12 @@ int labx_eth_initialize(bd_t *bis)
   dev->halt   =  labx_eth_halt;
   dev->send   =  labx_eth_send;
   dev->recv   =  labx_eth_recv;
+#ifdef CONFIG_NET_RX_FILTER
+  dev->rx_filter = labx_eth_rx_filter;
+#endif
+#ifdef CONFIG_MCAST_TFTP
+  dev->mcast  =  labx_eth_mcast;
+#endif
   
   eth_register(dev);
   
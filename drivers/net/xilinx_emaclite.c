@@ -62,10 +62,35 @@
 /* Recv interrupt enable bit */
 #define XEL_RSR_RECV_IE_MASK		0x00000008UL
 
+/* Polls of 10us waiting for a TX buffer before giving up */
+#define XEL_TX_TIMEOUT		1000
+
+/*
+ * Whether the core was built with the second (pong) buffer in each
+ * direction.  The board configuration normally derives these from the
+ * C_TX_PING_PONG / C_RX_PING_PONG parameters in xparameters.h; the old
+ * CONFIG_XILINX_EMACLITE_{TX,RX}_PING_PONG switches still force them on,
+ * whatever xparameters.h says.
+ */
+#ifdef CONFIG_XILINX_EMACLITE_TX_PING_PONG
+# undef XILINX_EMACLITE_TX_PING_PONG
+# define XILINX_EMACLITE_TX_PING_PONG	1
+#elif !defined(XILINX_EMACLITE_TX_PING_PONG)
+# define XILINX_EMACLITE_TX_PING_PONG	0
+#endif
+#ifdef CONFIG_XILINX_EMACLITE_RX_PING_PONG
+# undef XILINX_EMACLITE_RX_PING_PONG
+# define XILINX_EMACLITE_RX_PING_PONG	1
+#elif !defined(XILINX_EMACLITE_RX_PING_PONG)
+# define XILINX_EMACLITE_RX_PING_PONG	0
+#endif
+
 typedef struct {
 	u32 baseaddress;	/* Base address for device (IPIF) */
 	u32 nexttxbuffertouse;	/* Next TX buffer to write to */
 	u32 nextrxbuffertouse;	/* Next RX buffer to read from */
+	u32 txpingpong;		/* TX pong buffer present */
+	u32 rxpingpong;		/* RX pong buffer present */
 	uchar deviceid;		/* Unique ID of device - for future */
 } xemaclite;
 
@@ -137,6 +162,8 @@ static int emaclite_init(struct eth_device *dev, bd_t *bis)
 	debug ("EmacLite Initialization Started\n");
 	memset (&emaclite, 0, sizeof (xemaclite));
 	emaclite.baseaddress = dev->iobase;
+	emaclite.txpingpong = XILINX_EMACLITE_TX_PING_PONG;
+	emaclite.rxpingpong = XILINX_EMACLITE_RX_PING_PONG;
 
 /*
  * TX - TX_PING & TX_PONG initialization
@@ -154,65 +181,57 @@ static int emaclite_init(struct eth_device *dev, bd_t *bis)
 	while ((in_be32 (emaclite.baseaddress + XEL_TSR_OFFSET) &
 		XEL_TSR_PROG_MAC_ADDR) != 0) ;
 
-#ifdef CONFIG_XILINX_EMACLITE_TX_PING_PONG
-	/* The same operation with PONG TX */
-	out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET + XEL_BUFFER_OFFSET, 0);
-	xemaclite_alignedwrite (dev->enetaddr, emaclite.baseaddress +
-		XEL_BUFFER_OFFSET, ENET_ADDR_LENGTH);
-	out_be32 (emaclite.baseaddress + XEL_TPLR_OFFSET, ENET_ADDR_LENGTH);
-	out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET + XEL_BUFFER_OFFSET,
-		XEL_TSR_PROG_MAC_ADDR);
-	while ((in_be32 (emaclite.baseaddress + XEL_TSR_OFFSET +
-		XEL_BUFFER_OFFSET) & XEL_TSR_PROG_MAC_ADDR) != 0) ;
-#endif
+	if (emaclite.txpingpong) {
+		/* The same operation with PONG TX */
+		out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET +
+			XEL_BUFFER_OFFSET, 0);
+		xemaclite_alignedwrite (dev->enetaddr, emaclite.baseaddress +
+			XEL_BUFFER_OFFSET, ENET_ADDR_LENGTH);
+		out_be32 (emaclite.baseaddress + XEL_TPLR_OFFSET +
+			XEL_BUFFER_OFFSET, ENET_ADDR_LENGTH);
+		out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET +
+			XEL_BUFFER_OFFSET, XEL_TSR_PROG_MAC_ADDR);
+		while ((in_be32 (emaclite.baseaddress + XEL_TSR_OFFSET +
+			XEL_BUFFER_OFFSET) & XEL_TSR_PROG_MAC_ADDR) != 0) ;
+	}
 
 /*
  * RX - RX_PING & RX_PONG initialization
  */
 	/* Write out the value to flush the RX buffer */
 	out_be32 (emaclite.baseaddress + XEL_RSR_OFFSET, XEL_RSR_RECV_IE_MASK);
-#ifdef CONFIG_XILINX_EMACLITE_RX_PING_PONG
-	out_be32 (emaclite.baseaddress + XEL_RSR_OFFSET + XEL_BUFFER_OFFSET,
-		XEL_RSR_RECV_IE_MASK);
-#endif
+	if (emaclite.rxpingpong)
+		out_be32 (emaclite.baseaddress + XEL_RSR_OFFSET +
+			XEL_BUFFER_OFFSET, XEL_RSR_RECV_IE_MASK);
 
 	debug ("EmacLite Initialization complete\n");
 	return 0;
 }
 
-static int xemaclite_txbufferavailable (xemaclite * instanceptr)
+static int xemaclite_txbufferfree (u32 baseaddress)
 {
-	u32 reg;
-	u32 txpingbusy;
-	u32 txpongbusy;
-	/*
-	 * Read the other buffer register
-	 * and determine if the other buffer is available
-	 */
-	reg = in_be32 (instanceptr->baseaddress +
-			instanceptr->nexttxbuffertouse + 0);
-	txpingbusy = ((reg & XEL_TSR_XMIT_BUSY_MASK) ==
-			XEL_TSR_XMIT_BUSY_MASK);
-
-	reg = in_be32 (instanceptr->baseaddress +
-			(instanceptr->nexttxbuffertouse ^ XEL_TSR_OFFSET) + 0);
-	txpongbusy = ((reg & XEL_TSR_XMIT_BUSY_MASK) ==
-			XEL_TSR_XMIT_BUSY_MASK);
-
-	return (!(txpingbusy && txpongbusy));
+	u32 reg = in_be32 (baseaddress + XEL_TSR_OFFSET);
+
+	return (reg & (XEL_TSR_XMIT_BUSY_MASK | XEL_TSR_XMIT_ACTIVE_MASK)) == 0;
 }
 
+/*
+ * Frames are handed to the core and not waited for.  With the pong buffer
+ * present the next frame is copied into the idle buffer while the previous
+ * one is still on the wire, so a wait only happens when both are busy.
+ */
 static int emaclite_send (struct eth_device *dev, volatile void *ptr, int len)
 {
 	u32 reg;
 	u32 baseaddress;
-
-	u32 maxtry = 1000;
+	u32 maxtry = XEL_TX_TIMEOUT;
 
 	if (len > ENET_MAX_MTU)
 		len = ENET_MAX_MTU;
 
-	while (!xemaclite_txbufferavailable (&emaclite) && maxtry) {
+	/* The buffers are used in turn, so the core sends frames in order */
+	baseaddress = emaclite.baseaddress + emaclite.nexttxbuffertouse;
+	while (!xemaclite_txbufferfree (baseaddress) && maxtry) {
 		udelay (10);
 		maxtry--;
 	}
@@ -221,92 +240,36 @@ static int emaclite_send (struct eth_device *dev, volatile void *ptr, int len)
 		printf ("Error: Timeout waiting for ethernet TX buffer\n");
 		/* Restart PING TX */
 		out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET, 0);
-#ifdef CONFIG_XILINX_EMACLITE_TX_PING_PONG
-		out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET +
-		XEL_BUFFER_OFFSET, 0);
-#endif
+		if (emaclite.txpingpong)
+			out_be32 (emaclite.baseaddress + XEL_TSR_OFFSET +
+				XEL_BUFFER_OFFSET, 0);
+		emaclite.nexttxbuffertouse = 0;
 		return 0;
 	}
 
-	/* Determine the expected TX buffer address */
-	baseaddress = (emaclite.baseaddress + emaclite.nexttxbuffertouse);
-
-	/* Determine if the expected buffer address is empty */
-	reg = in_be32 (baseaddress + XEL_TSR_OFFSET);
-	if (((reg & XEL_TSR_XMIT_BUSY_MASK) == 0)
-		&& ((in_be32 ((baseaddress) + XEL_TSR_OFFSET)
-			& XEL_TSR_XMIT_ACTIVE_MASK) == 0)) {
-
-#ifdef CONFIG_XILINX_EMACLITE_TX_PING_PONG
+	if (emaclite.txpingpong)
 		emaclite.nexttxbuffertouse ^= XEL_BUFFER_OFFSET;
-#endif
-		debug ("Send packet from 0x%x\n", baseaddress);
-		/* Write the frame to the buffer */
-		xemaclite_alignedwrite ((void *) ptr, baseaddress, len);
-		out_be32 (baseaddress + XEL_TPLR_OFFSET,(len &
-			(XEL_TPLR_LENGTH_MASK_HI | XEL_TPLR_LENGTH_MASK_LO)));
-		reg = in_be32 (baseaddress + XEL_TSR_OFFSET);
-		reg |= XEL_TSR_XMIT_BUSY_MASK;
-		if ((reg & XEL_TSR_XMIT_IE_MASK) != 0) {
-			reg |= XEL_TSR_XMIT_ACTIVE_MASK;
-		}
-		out_be32 (baseaddress + XEL_TSR_OFFSET, reg);
-		return 1;
-	}
-#ifdef CONFIG_XILINX_EMACLITE_TX_PING_PONG
-	/* Switch to second buffer */
-	baseaddress ^= XEL_BUFFER_OFFSET;
-	/* Determine if the expected buffer address is empty */
+
+	debug ("Send packet from 0x%x\n", baseaddress);
+	/* Write the frame to the buffer */
+	xemaclite_alignedwrite ((void *) ptr, baseaddress, len);
+	out_be32 (baseaddress + XEL_TPLR_OFFSET,(len &
+		(XEL_TPLR_LENGTH_MASK_HI | XEL_TPLR_LENGTH_MASK_LO)));
 	reg = in_be32 (baseaddress + XEL_TSR_OFFSET);
-	if (((reg & XEL_TSR_XMIT_BUSY_MASK) == 0)
-		&& ((in_be32 ((baseaddress) + XEL_TSR_OFFSET)
-			& XEL_TSR_XMIT_ACTIVE_MASK) == 0)) {
-		debug ("Send packet from 0x%x\n", baseaddress);
-		/* Write the frame to the buffer */
-		xemaclite_alignedwrite ((void *) ptr, baseaddress, len);
-		out_be32 (baseaddress + XEL_TPLR_OFFSET,(len &
-			(XEL_TPLR_LENGTH_MASK_HI | XEL_TPLR_LENGTH_MASK_LO)));
-		reg = in_be32 (baseaddress + XEL_TSR_OFFSET);
-		reg |= XEL_TSR_XMIT_BUSY_MASK;
-		if ((reg & XEL_TSR_XMIT_IE_MASK) != 0) {
-			reg |= XEL_TSR_XMIT_ACTIVE_MASK;
-		}
-		out_be32 (baseaddress + XEL_TSR_OFFSET, reg);
-		return 1;
+	reg |= XEL_TSR_XMIT_BUSY_MASK;
+	if ((reg & XEL_TSR_XMIT_IE_MASK) != 0) {
+		reg |= XEL_TSR_XMIT_ACTIVE_MASK;
 	}
-#endif
-	puts ("Error while sending frame\n");
-	return 0;
+	out_be32 (baseaddress + XEL_TSR_OFFSET, reg);
+	return 1;
 }
 
-static int emaclite_recv(struct eth_device *dev)
+/* Pass the frame waiting in the RX buffer at baseaddress up the stack */
+static void emaclite_recv_buffer (u32 baseaddress)
 {
 	u32 length;
 	u32 reg;
-	u32 baseaddress;
 
-	baseaddress = emaclite.baseaddress + emaclite.nextrxbuffertouse;
-	reg = in_be32 (baseaddress + XEL_RSR_OFFSET);
-	debug ("Testing data at address 0x%x\n", baseaddress);
-	if ((reg & XEL_RSR_RECV_DONE_MASK) == XEL_RSR_RECV_DONE_MASK) {
-#ifdef CONFIG_XILINX_EMACLITE_RX_PING_PONG
-		emaclite.nextrxbuffertouse ^= XEL_BUFFER_OFFSET;
-#endif
-	} else {
-#ifndef CONFIG_XILINX_EMACLITE_RX_PING_PONG
-		debug ("No data was available - address 0x%x\n", baseaddress);
-		return 0;
-#else
-		baseaddress ^= XEL_BUFFER_OFFSET;
-		reg = in_be32 (baseaddress + XEL_RSR_OFFSET);
-		if ((reg & XEL_RSR_RECV_DONE_MASK) !=
-					XEL_RSR_RECV_DONE_MASK) {
-			debug ("No data was available - address 0x%x\n",
-					baseaddress);
-			return 0;
-		}
-#endif
-	}
 	/* Get the length of the frame that arrived */
 	switch(((in_be32 (baseaddress + XEL_RXBUFF_OFFSET + 0xC)) &
 			0xFFFF0000 ) >> 16) {
@@ -329,15 +292,57 @@ static int emaclite_recv(struct eth_device *dev)
 	xemaclite_alignedread ((u32 *) (baseaddress + XEL_RXBUFF_OFFSET),
 			etherrxbuff, length);
 
-	/* Acknowledge the frame */
+	/* Acknowledge the frame so the core can refill the buffer */
 	reg = in_be32 (baseaddress + XEL_RSR_OFFSET);
 	reg &= ~XEL_RSR_RECV_DONE_MASK;
 	out_be32 (baseaddress + XEL_RSR_OFFSET, reg);
 
 	debug ("Packet receive from 0x%x, length %dB\n", baseaddress, length);
 	NetReceive ((uchar *) etherrxbuff, length);
-	return 1;
+}
+
+/*
+ * The core fills the RX buffers alternately, so check the one expected
+ * next and then the other; a burst can leave frames waiting in both.
+ */
+static int emaclite_recv(struct eth_device *dev)
+{
+	u32 baseaddress;
+	int i;
+	int count = 0;
+
+	for (i = 0; i < (emaclite.rxpingpong ? 2 : 1); i++) {
+		baseaddress = emaclite.baseaddress + emaclite.nextrxbuffertouse;
+		debug ("Testing data at address 0x%x\n", baseaddress);
+		if ((in_be32 (baseaddress + XEL_RSR_OFFSET) &
+				XEL_RSR_RECV_DONE_MASK) == 0) {
+			if (count || !emaclite.rxpingpong)
+				break;
+
+			/* Resynchronise if the core got ahead of us */
+			baseaddress ^= XEL_BUFFER_OFFSET;
+			if ((in_be32 (baseaddress + XEL_RSR_OFFSET) &
+					XEL_RSR_RECV_DONE_MASK) == 0)
+				break;
+			emaclite.nextrxbuffertouse ^= XEL_BUFFER_OFFSET;
+		}
+
+		if (emaclite.rxpingpong)
+			emaclite.nextrxbuffertouse ^= XEL_BUFFER_OFFSET;
+
+		emaclite_recv_buffer (baseaddress);
+		count++;
+
+		/* A handler may have finished the transfer */
+		if (NetState != NETLOOP_CONTINUE)
+			break;
+	}
+
+	if (!count)
+		debug ("No data was available - address 0x%x\n",
+			emaclite.baseaddress + emaclite.nextrxbuffertouse);
 
+	return count;
 }
 
 int xilinx_emaclite_initialize (bd_t *bis)
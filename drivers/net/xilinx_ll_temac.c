@@ -55,6 +55,10 @@
 # define RX_CHNL_STS		(((struct ll_priv *)(dev->priv))->sdma + 0x3c)
 
 # define DMA_CONTROL_REG	(((struct ll_priv *)(dev->priv))->sdma + 0x40)
+
+# define CHNL_STS_ERROR		0x00000080
+# define DMA_CONTROL_RESET	0x00000001
+# define DMA_TAIL_ENABLE	0x00000004
 #endif
 
 /* XPS_LL_TEMAC direct registers definition */
@@ -130,8 +134,23 @@ typedef struct cdmac_bd_t {
 	unsigned long app5;
 } cdmac_bd __attribute((aligned(32))) ;
 
-static cdmac_bd	tx_bd;
-static cdmac_bd	rx_bd;
+/* Ring sizes; each Rx descriptor owns one of the net core's NetRxPackets[] */
+# define RX_BD_COUNT	PKTBUFSRX
+# ifdef CONFIG_SYS_TX_ETH_BUFFER
+#  define TX_BD_COUNT	CONFIG_SYS_TX_ETH_BUFFER
+# else
+#  define TX_BD_COUNT	4
+# endif
+
+# define TX_TIMEOUT	100	/* msec to wait for a Tx descriptor */
+
+static cdmac_bd	rx_ring[RX_BD_COUNT];
+static cdmac_bd	tx_ring[TX_BD_COUNT];
+static int rx_head;	/* next Rx descriptor to complete */
+static int tx_head;	/* next free Tx descriptor */
+static int tx_tail;	/* oldest Tx descriptor not reclaimed */
+static int tx_count;	/* Tx descriptors owned by the DMA */
+static unsigned int ring_generation;	/* bumped when the rings are rebuilt */
 #endif
 
 #ifdef FIFO_MODE
@@ -153,9 +172,13 @@ ll_fifo_s *ll_fifo = (ll_fifo_s *) (XILINX_LLTEMAC_FIFO_BASEADDR);
 #endif
 
 #ifdef SDMA_MODE
-static unsigned char tx_buffer[ETHER_MTU] __attribute((aligned(32)));
+static unsigned char tx_buffer[TX_BD_COUNT][PKTSIZE_ALIGN]
+					__attribute((aligned(32)));
+#endif
+#ifdef FIFO_MODE
+static int rx_next;	/* NetRxPackets[] entry for the next frame */
+static int rx_backlog;	/* frames left in the FIFO by the last poll */
 #endif
-static unsigned char rx_buffer[ETHER_MTU] __attribute((aligned(32)));
 
 struct ll_priv {
 	unsigned int sdma;
@@ -287,78 +310,172 @@ static int xps_ll_temac_phy_ctrl(struct eth_device *dev)
 }
 
 #ifdef SDMA_MODE
-/* bd init */
+static void bd_flush(cdmac_bd *bd)
+{
+	flush_dcache_range((ulong)bd, (ulong)bd + sizeof(cdmac_bd));
+}
+
+static void bd_invalidate(cdmac_bd *bd)
+{
+	invalidate_dcache_range((ulong)bd, (ulong)bd + sizeof(cdmac_bd));
+}
+
+/* give an Rx descriptor (back) to the DMA, with no dirty lines in its buffer */
+static void xps_ll_temac_rx_arm(cdmac_bd *bd)
+{
+	invalidate_dcache_range((ulong)bd->phys_buf_p,
+				(ulong)bd->phys_buf_p + ETHER_MTU);
+	bd->buf_len = ETHER_MTU;
+	bd->stat = 0;
+	bd->app5 = 0;
+	bd_flush(bd);
+}
+
+/* reset the SDMA and build the rings; all Rx descriptors go to the DMA */
 static void xps_ll_temac_bd_init(struct eth_device *dev)
 {
-	memset((void *)&tx_bd, 0, sizeof(cdmac_bd));
-	memset((void *)&rx_bd, 0, sizeof(cdmac_bd));
+	int i;
 
-	rx_bd.phys_buf_p = &rx_buffer[0];
+	out_be32((u32 *)DMA_CONTROL_REG, DMA_CONTROL_RESET);
+	while (in_be32((u32 *)DMA_CONTROL_REG) & DMA_CONTROL_RESET)
+		;
+	out_be32((u32 *)DMA_CONTROL_REG, DMA_TAIL_ENABLE);
 
-	rx_bd.next_p = &rx_bd;
-	rx_bd.buf_len = ETHER_MTU;
-	flush_cache((u32)&rx_bd, sizeof(cdmac_bd));
+	memset((void *)rx_ring, 0, sizeof(rx_ring));
+	for (i = 0; i < RX_BD_COUNT; i++) {
+		rx_ring[i].next_p = &rx_ring[(i + 1) % RX_BD_COUNT];
+		rx_ring[i].phys_buf_p = (unsigned char *)NetRxPackets[i];
+		xps_ll_temac_rx_arm(&rx_ring[i]);
+	}
+	rx_head = 0;
+
+	memset((void *)tx_ring, 0, sizeof(tx_ring));
+	for (i = 0; i < TX_BD_COUNT; i++) {
+		tx_ring[i].next_p = &tx_ring[(i + 1) % TX_BD_COUNT];
+		tx_ring[i].phys_buf_p = tx_buffer[i];
+	}
+	flush_dcache_range((ulong)tx_ring, (ulong)tx_ring + sizeof(tx_ring));
+	tx_head = tx_tail = tx_count = 0;
 
-	out_be32((u32 *)RX_CURDESC_PTR, (u32)&rx_bd);
-	out_be32((u32 *)RX_TAILDESC_PTR, (u32)&rx_bd);
-	out_be32((u32 *)RX_NXTDESC_PTR, (u32)&rx_bd); /* setup first fd */
+	out_be32((u32 *)RX_CURDESC_PTR, (u32)&rx_ring[0]);
+	out_be32((u32 *)RX_TAILDESC_PTR, (u32)&rx_ring[RX_BD_COUNT - 1]);
+	out_be32((u32 *)TX_CURDESC_PTR, (u32)&tx_ring[0]);
+	ring_generation++;
+}
 
-	tx_bd.phys_buf_p = &tx_buffer[0];
-	tx_bd.next_p = &tx_bd;
+/* reclaim the Tx descriptors the DMA has finished with */
+static void xps_ll_temac_tx_reclaim(void)
+{
+	cdmac_bd *bd;
+
+	while (tx_count > 0) {
+		bd = &tx_ring[tx_tail];
+		bd_invalidate(bd);
+		if (!(bd->stat & BDSTAT_COMPLETED_MASK))
+			break;
+
+		bd->stat = 0;
+		bd_flush(bd);
+		tx_tail = (tx_tail + 1) % TX_BD_COUNT;
+		tx_count--;
+	}
+}
 
-	flush_cache((u32)&tx_bd, sizeof(cdmac_bd));
-	out_be32((u32 *)TX_CURDESC_PTR, (u32)&tx_bd);
+/* wait until at most count Tx descriptors are still owned by the DMA */
+static int xps_ll_temac_tx_drain(struct eth_device *dev, int count)
+{
+	ulong start = get_timer(0);
+
+	for (;;) {
+		if (in_be32((u32 *)TX_CHNL_STS) & CHNL_STS_ERROR) {
+			printf("LL_TEMAC: Tx DMA error\n");
+			xps_ll_temac_bd_init(dev);
+			return -1;
+		}
+
+		xps_ll_temac_tx_reclaim();
+		if (tx_count <= count)
+			return 0;
+
+		if (get_timer(start) > TX_TIMEOUT) {
+			printf("LL_TEMAC: Tx DMA timeout\n");
+			xps_ll_temac_bd_init(dev);
+			return -1;
+		}
+	}
 }
 
 static int xps_ll_temac_send_sdma(struct eth_device *dev,
 				unsigned char *buffer, int length)
 {
+	cdmac_bd *bd;
+
 	if( xps_ll_temac_phy_ctrl(dev) == 0)
 		return 0;
 
-	memcpy (tx_buffer, buffer, length);
-	flush_cache ((u32)tx_buffer, length);
+	if (tx_count == TX_BD_COUNT &&
+	    xps_ll_temac_tx_drain(dev, TX_BD_COUNT - 1))
+		return 0;
 
-	tx_bd.stat = BDSTAT_SOP_MASK | BDSTAT_EOP_MASK | \
-			BDSTAT_STOP_ON_END_MASK;
-	tx_bd.buf_len = length;
-	flush_cache ((u32)&tx_bd, sizeof(cdmac_bd));
+	/*
+	 * Copy the frame to the descriptor's buffer: the net core builds the
+	 * next frame in the same NetTxPacket while this one is in flight.
+	 */
+	bd = &tx_ring[tx_head];
+	memcpy (bd->phys_buf_p, buffer, length);
+	flush_dcache_range((ulong)bd->phys_buf_p,
+			   (ulong)bd->phys_buf_p + length);
 
-	out_be32((u32 *)TX_CURDESC_PTR, (u32)&tx_bd);
-	out_be32((u32 *)TX_TAILDESC_PTR, (u32)&tx_bd); /* DMA start */
+	bd->stat = BDSTAT_SOP_MASK | BDSTAT_EOP_MASK;
+	bd->buf_len = length;
+	bd_flush(bd);
 
-	do {
-		flush_cache ((u32)&tx_bd, sizeof(cdmac_bd));
-	} while(!(((volatile int)tx_bd.stat) & BDSTAT_COMPLETED_MASK));
+	out_be32((u32 *)TX_TAILDESC_PTR, (u32)bd); /* DMA start */
+	tx_head = (tx_head + 1) % TX_BD_COUNT;
+	tx_count++;
 
 	return length;
 }
 
+/* pass every completed frame up, re-arming each descriptor after use */
 static int xps_ll_temac_recv_sdma(struct eth_device *dev)
 {
+	cdmac_bd *bd;
 	int length;
+	int frames;
+	unsigned int generation = ring_generation;
 
-	flush_cache ((u32)&rx_bd, sizeof(cdmac_bd));
-
-	if(!(rx_bd.stat & BDSTAT_COMPLETED_MASK)) {
+	if (in_be32((u32 *)RX_CHNL_STS) & CHNL_STS_ERROR) {
+		printf("LL_TEMAC: Rx DMA error\n");
+		xps_ll_temac_bd_init(dev);
 		return 0;
 	}
 
-	length = rx_bd.app5 & 0x3FFF;
-	flush_cache ((u32)rx_bd.phys_buf_p, length);
-
-	rx_bd.buf_len = ETHER_MTU;
-	rx_bd.stat = 0;
-	rx_bd.app5 = 0;
-
-	flush_cache ((u32)&rx_bd, sizeof(cdmac_bd));
-	out_be32((u32 *)RX_TAILDESC_PTR, (u32)&rx_bd);
-
-	if(length > 0) {
-		NetReceive(rx_bd.phys_buf_p, length);
+	for (frames = 0; frames < RX_BD_COUNT; frames++) {
+		bd = &rx_ring[rx_head];
+		bd_invalidate(bd);
+		if (!(bd->stat & BDSTAT_COMPLETED_MASK))
+			break;
+
+		length = bd->app5 & 0x3FFF;
+		invalidate_dcache_range((ulong)bd->phys_buf_p,
+					(ulong)bd->phys_buf_p + length);
+		if (length > 0)
+			NetReceive(bd->phys_buf_p, length);
+
+		/*
+		 * NetReceive() may have restarted the transfer, which
+		 * re-inits the device and rebuilds the rings under us.
+		 */
+		if (ring_generation != generation)
+			return frames + 1;
+
+		xps_ll_temac_rx_arm(bd);
+		out_be32((u32 *)RX_TAILDESC_PTR, (u32)bd);
+		rx_head = (rx_head + 1) % RX_BD_COUNT;
 	}
 
-	return length;
+	return frames;
 }
 #endif
 
@@ -377,7 +494,7 @@ static int xps_ll_temac_send_fifo(unsigned char *buffer, int length)
 	u32 *buf = (u32 *)buffer;
 	u32 len, i, val;
 
-	len = (length / 4) + 1;
+	len = (length + 3) / 4;
 
 	for (i = 0; i < len; i++) {
 		val = *buf++;
@@ -389,27 +506,70 @@ static int xps_ll_temac_send_fifo(unsigned char *buffer, int length)
 	return length;
 }
 
+/* copy a frame out of the Rx data FIFO, four words per loop */
+static void xps_ll_temac_read_fifo(u32 *buf, u32 len)
+{
+	volatile int *rdfd = &ll_fifo->rdfd;
+	u32 words = (len + 3) / 4;
+
+	while (words >= 4) {
+		u32 w0 = *rdfd, w1 = *rdfd, w2 = *rdfd, w3 = *rdfd;
+
+		buf[0] = w0; buf[1] = w1; buf[2] = w2; buf[3] = w3;
+		buf += 4;
+		words -= 4;
+	}
+	while (words--)
+		*buf++ = *rdfd;
+}
+
+/* throw away a frame too long for a receive buffer */
+static void xps_ll_temac_drop_fifo(u32 len)
+{
+	volatile int *rdfd = &ll_fifo->rdfd;
+	u32 words = (len + 3) / 4;
+
+	while (words--)
+		(void)*rdfd;
+}
+
 static int xps_ll_temac_recv_fifo(void)
 {
-	u32 len, len2, i, val;
-	u32 *buf = (u32 *)&rx_buffer;
+	uchar *buf;
+	u32 len;
+	int frames = 0;
+
+	if (!rx_backlog && !(ll_fifo->isr & 0x04000000))
+		return 0;
+
+	/*
+	 * Acknowledge first, so a frame completing while the FIFO is being
+	 * drained raises the flag again.  Stop after a full pass of the
+	 * receive buffers, or once the network loop is done, and remember
+	 * if anything was left behind.
+	 */
+	ll_fifo->isr = 0xffffffff; /* reset isr */
+	rx_backlog = 0;
 
-	if (ll_fifo->isr & 0x04000000 ) {
-		ll_fifo->isr = 0xffffffff; /* reset isr */
-	
-		/* while (ll_fifo->isr); */
+	while (ll_fifo->rdfo != 0) {
 		len = ll_fifo->rlf & 0x7FF;
-		len2 = (len / 4) + 1;
-	
-		for (i = 0; i < len2; i++) {
-			val = ll_fifo->rdfd;
-			*buf++ = val ;
+		if (len > PKTSIZE_ALIGN) {
+			xps_ll_temac_drop_fifo(len);
+		} else {
+			buf = (uchar *)NetRxPackets[rx_next];
+			rx_next = (rx_next + 1) % PKTBUFSRX;
+
+			xps_ll_temac_read_fifo((u32 *)buf, len);
+			NetReceive(buf, len);
+		}
+
+		if (++frames == PKTBUFSRX || NetState != NETLOOP_CONTINUE) {
+			rx_backlog = (ll_fifo->rdfo != 0);
+			break;
 		}
-	
-		/* debugll(1); */
-		NetReceive ((uchar *)&rx_buffer, len);
 	}
-	return 0;
+
+	return frames;
 }
 #endif
 
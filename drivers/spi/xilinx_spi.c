@@ -122,6 +122,19 @@ void spi_release_bus(struct spi_slave *slave)
 # define CONFIG_XILINX_SPI_IDLE_VAL 0xee
 #endif
 
+/*
+ * Number of bytes kept in flight in the core's TX/RX FIFOs.  The xps_spi
+ * core has 16-deep FIFOs when C_FIFO_EXIST is set; otherwise only a single
+ * byte may be outstanding.
+ */
+#ifndef CONFIG_XILINX_SPI_FIFO_DEPTH
+# if defined(XPAR_SPI_0_FIFO_EXIST) && (XPAR_SPI_0_FIFO_EXIST != 0)
+#  define CONFIG_XILINX_SPI_FIFO_DEPTH 16
+# else
+#  define CONFIG_XILINX_SPI_FIFO_DEPTH 1
+# endif
+#endif
+
 int spi_xfer(struct spi_slave *slave, unsigned int bitlen, const void *dout,
 	     void *din, unsigned long flags)
 {
@@ -149,17 +162,32 @@ int spi_xfer(struct spi_slave *slave, unsigned int bitlen, const void *dout,
 	if (flags & SPI_XFER_BEGIN)
 		spi_cs_activate(slave);
 
-	while (bytes--) {
-		uchar d = txp ? *txp++ : CONFIG_XILINX_SPI_IDLE_VAL;
-//		debug("%s: tx:%x ", __func__, d);
-		writel(d, xilspi->base + XILINX_SPI_TR);
-		while (readl(xilspi->base + XILINX_SPI_SR) &
-			 XILINX_SPI_SR_RX_EMPTY_MSK)
-			;
-		d = readl(xilspi->base + XILINX_SPI_RR);
-		if (rxp)
-			*rxp++ = d;
-//		debug("rx:%x\n", d);
+	/*
+	 * Fill the TX FIFO with up to a FIFO's worth of bytes before draining
+	 * the receive side, so the shifter runs back-to-back instead of idling
+	 * for a register round trip on every byte.
+	 */
+	while (bytes) {
+		uint burst = min(bytes, (uint)CONFIG_XILINX_SPI_FIFO_DEPTH);
+		uint i;
+
+		for (i = 0; i < burst; i++) {
+			uchar d = txp ? *txp++ : CONFIG_XILINX_SPI_IDLE_VAL;
+			writel(d, xilspi->base + XILINX_SPI_TR);
+		}
+
+		for (i = 0; i < burst; i++) {
+			uchar d;
+
+			while (readl(xilspi->base + XILINX_SPI_SR) &
+				 XILINX_SPI_SR_RX_EMPTY_MSK)
+				;
+			d = readl(xilspi->base + XILINX_SPI_RR);
+			if (rxp)
+				*rxp++ = d;
+		}
+
+		bytes -= burst;
 	}
  done:
 	if (flags & SPI_XFER_END)
@@ -0,0 +1,57 @@
+/*
+ * Boot stage timestamps
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef _BOOTSTAGE_H
+#define _BOOTSTAGE_H
+
+#ifdef CONFIG_BOOTSTAGE
+/*
+ * Record the current time under 'name', which must be a string that
+ * stays valid (normally a literal).  Returns the time in microseconds.
+ */
+ulong bootstage_mark (const char *name);
+
+/* Print all records and the time between them */
+void bootstage_report (void);
+
+/* Add the records to the /chosen/bootstage node of a device tree */
+int bootstage_fdt_add_report (void *blob);
+
+/* Microseconds since power on, may be overridden by the architecture */
+ulong timer_get_boot_us (void);
+#else
+static inline ulong bootstage_mark (const char *name)
+{
+	return 0;
+}
+
+static inline void bootstage_report (void)
+{
+}
+
+static inline int bootstage_fdt_add_report (void *blob)
+{
+	return 0;
+}
+#endif /* CONFIG_BOOTSTAGE */
+
+#endif /* _BOOTSTAGE_H */
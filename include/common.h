@@ -312,6 +312,9 @@ void	jumptable_init(void);
 /* common/kallsysm.c */
 const char *symbol_lookup(unsigned long addr, unsigned long *caddr);
 
+/* common/cmd_profile.c */
+void	profile_sample(unsigned long pc);
+
 /* api/api.c */
 void	api_init (void);
 
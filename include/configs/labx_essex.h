@@ -55,6 +55,18 @@
 /* Use the Lab X Ethernet driver */
 #define CONFIG_LABX_ETHERNET  1
 
+/* Receive buffers the driver cycles through while draining its FIFO */
+#define CONFIG_SYS_RX_ETH_BUFFER  8
+
+/* Drop broadcast traffic in the MAC filters when the protocol allows */
+#define CONFIG_NET_RX_FILTER
+
+/* Ask the TFTP server for one ACK per window of receive buffers */
+#define CONFIG_TFTP_WINDOWSIZE  8
+
+/* HTTP downloads; the default TCP window also matches the receive buffers */
+#define CONFIG_CMD_WGET
+
 /* Top-level configuration setting to determine whether AVB port 0 or 1
  * is used by U-Boot.  AVB 0 is on top at the card edge, with AVB 1
  * located underneath of it.
@@ -101,6 +113,8 @@
 #define	CONFIG_SYS_TIMER_0_IRQ	XPAR_INTC_0_TMRCTR_0_VEC_ID
 #define	FREQUENCE		XPAR_PROC_BUS_0_FREQ_HZ
 #define	CONFIG_SYS_TIMER_0_PRELOAD	( FREQUENCE/1000 )
+#define	CONFIG_SYS_TIMER_0_TIMEBASE	/* free-running counter on timer 1 */
+#define	CONFIG_SYS_TIMER_0_FREQ		XPAR_TMRCTR_0_CLOCK_FREQ_HZ
 
 /* FSL */
 /* #define	CONFIG_SYS_FSL_2 */
@@ -154,6 +168,9 @@
 /*#define	CONFIG_ENV_ADDR		(CONFIG_SYS_FLASH_BASE + CONFIG_SYS_FLASH_SIZE - CONFIG_ENV_SECT_SIZE)      */
 #define	CONFIG_ENV_SIZE		0x08000  /* Only 32K actually allocated */
 #define CONFIG_ENV_OFFSET	0xE40000	
+#define CONFIG_ENV_OFFSET_REDUND	0xE80000 /* second sector of the env log */
+#define CONFIG_ENV_SPI_LOG	/* append-only env records, erase on wrap */
+#define CONFIG_ENV_HASH		/* hashed index for getenv() lookups */
 
 /* Enable support of SPI Flash */
 #define CONFIG_SYS_NO_FLASH
@@ -169,6 +186,7 @@
 #define CONFIG_ENV_SPI_BUS 0/* by default, bus 0 is used */
 #define CONFIG_ENV_SPI_CS 0 /* by default, the CS the bootrom uses */
 #define CONFIG_SPI_FLASH_SPANSION 1
+#define CONFIG_SPI_FLASH_STREAM 1 /* tftpboot sf:<offset> */
 
 /* Definitions for peripheral FLASH_CONTROL */
 #define XPAR_FLASH_CONTROL_NUM_BANKS_MEM 1
@@ -223,6 +241,10 @@
 
 #define CONFIG_CMD_SAVEENV
 #define CONFIG_CMD_SAVES
+#define CONFIG_CMD_BOOTSTAGE	/* bootstage report */
+#define CONFIG_CMD_PROFILE	/* timer interrupt sampling profiler */
+/* CONFIG_KALLSYMS only in labx_essex_PROFILE_config: the system map may
+ * not fit the 0x40000 bootsize partition */
 
 /* JFFS2 partitions */
 #define CONFIG_CMD_MTDPARTS	/* mtdparts command line support */
@@ -251,13 +273,19 @@
 /* architecture dependent code */
 #define	CONFIG_SYS_USR_EXCEP	/* user exception */
 #define CONFIG_SYS_HZ	1000
+#define CONFIG_CRC32_SLICING	4	/* 4KB of tables, fits the 8KB dcache */
+#define CONFIG_BOOTSTAGE	/* record boot stage timestamps */
+#define CONFIG_ZLIB_INFLATE_FAST	/* word-wise match copies in gunzip */
+#define CONFIG_ZSOURCE		/* bootm sf:<offset> streams from flash */
 
 #define CONFIG_CMDLINE_EDITING
+#define CONFIG_SYS_SORTED_CMD_TABLE	/* binary search in find_cmd() */
 
 /* Use the HUSH parser */
 #define CONFIG_SYS_HUSH_PARSER
 #ifdef  CONFIG_SYS_HUSH_PARSER
 #define CONFIG_SYS_PROMPT_HUSH_PS2 "> "
+#define CONFIG_HUSH_CACHE	/* reuse parsed run/bootcmd scripts */
 #endif
 
 /* Flat device tree support */
@@ -65,6 +65,15 @@
 #ifdef XPAR_EMACLITE_0_BASEADDR
 	#define XILINX_EMACLITE_BASEADDR XPAR_EMACLITE_0_BASEADDR
 	#define CONFIG_XILINX_EMACLITE	1
+	/* Use the pong buffers whenever the core was built with them */
+	#ifdef XPAR_EMACLITE_0_TX_PING_PONG
+		#define XILINX_EMACLITE_TX_PING_PONG \
+			XPAR_EMACLITE_0_TX_PING_PONG
+	#endif
+	#ifdef XPAR_EMACLITE_0_RX_PING_PONG
+		#define XILINX_EMACLITE_RX_PING_PONG \
+			XPAR_EMACLITE_0_RX_PING_PONG
+	#endif
 	#define CONFIG_SYS_ENET
 #elif XPAR_LLTEMAC_0_BASEADDR
 	#define XILINX_LLTEMAC_BASEADDR XPAR_LLTEMAC_0_BASEADDR
@@ -77,6 +86,9 @@
 	#endif
 	#define CONFIG_XILINX_LL_TEMAC	1
 	#define CONFIG_SYS_ENET
+	/* Rx ring / FIFO drain buffers and Tx ring descriptors */
+	#define CONFIG_SYS_RX_ETH_BUFFER	8
+	#define CONFIG_SYS_TX_ETH_BUFFER	4
 #endif
 
 #undef ET_DEBUG
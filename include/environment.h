@@ -153,4 +153,15 @@ void env_crc_update (void);
 /* [re]set to the default environment */
 void set_default_env(void);
 
+#ifdef CONFIG_ENV_HASH
+/* Rebuild the getenv() index after the RAM copy has been replaced */
+void env_hash_rebuild(void);
+
+/* Index the environment in env[0..size), 0 if it can be used */
+int env_hash_build (const unsigned char *env, int size);
+
+/* Offset in env of the value of "name", or -1 */
+int env_hash_find (const unsigned char *env, const char *name);
+#endif
+
 #endif	/* _ENVIRONMENT_H_ */
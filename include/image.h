@@ -56,6 +56,8 @@
 #include <fdt_support.h>
 #define CONFIG_MD5		/* FIT images need MD5 support */
 #define CONFIG_SHA1		/* and SHA1 */
+#include <u-boot/md5.h>
+#include <sha1.h>
 #endif
 
 /*
@@ -245,6 +247,12 @@ typedef struct bootm_headers {
 #endif
 
 	int		verify;		/* getenv("verify")[0] != 'n' */
+	int		dcrc_on_load;	/* os data CRC checked by the load copy */
+	struct zsource	*os_src;	/* os data streamed from here, or NULL */
+	/* the parts of an image read from flash that are in RAM */
+	int		os_ram_cnt;
+	ulong		os_ram_start[3];/* FIT blob, ramdisk, FDT */
+	ulong		os_ram_end[3];
 
 #define	BOOTM_STATE_START	(0x00000001)
 #define	BOOTM_STATE_LOADOS	(0x00000002)
@@ -535,6 +543,8 @@ static inline int image_check_target_arch (const image_header_t *hdr)
 #define FIT_COMP_PROP		"compression"
 #define FIT_ENTRY_PROP		"entry"
 #define FIT_LOAD_PROP		"load"
+#define FIT_DATA_OFFSET_PROP	"data-offset"
+#define FIT_DATA_SIZE_PROP	"data-size"
 
 /* configuration node */
 #define FIT_KERNEL_PROP		"kernel"
@@ -543,6 +553,7 @@ static inline int image_check_target_arch (const image_header_t *hdr)
 #define FIT_DEFAULT_PROP	"default"
 
 #define FIT_MAX_HASH_LEN	20	/* max(crc32_len(4), sha1_len(20)) */
+#define FIT_MAX_HASHES		4	/* hash nodes checked while streaming */
 
 /* cmdline argument format parsing */
 inline int fit_parse_conf (const char *spec, ulong addr_curr,
@@ -567,17 +578,22 @@ static inline ulong fit_get_size (const void *fit)
 }
 
 /**
- * fit_get_end - get FIT image end
+ * fit_get_ext_base - get offset of external image data
  * @fit: pointer to the FIT format image header
  *
+ * Image data stored outside the blob (data-offset/data-size properties)
+ * is placed after the blob, starting at the next 4 byte boundary.
+ *
  * returns:
- *     end address of the FIT image (blob) in memory
+ *     offset from the FIT start that data-offset values are relative to
  */
-static inline ulong fit_get_end (const void *fit)
+static inline ulong fit_get_ext_base (const void *fit)
 {
-	return (ulong)fit + fdt_totalsize (fit);
+	return (fdt_totalsize (fit) + 3) & ~3;
 }
 
+ulong fit_get_end (const void *fit);
+
 /**
  * fit_get_name - get FIT node name
  * @fit: pointer to the FIT format image header
@@ -604,6 +620,8 @@ int fit_image_get_load (const void *fit, int noffset, ulong *load);
 int fit_image_get_entry (const void *fit, int noffset, ulong *entry);
 int fit_image_get_data (const void *fit, int noffset,
 				const void **data, size_t *size);
+int fit_image_get_data_ext (const void *fit, int noffset,
+				ulong *offset, size_t *size);
 
 int fit_image_hash_get_algo (const void *fit, int noffset, char **algo);
 int fit_image_hash_get_value (const void *fit, int noffset, uint8_t **value,
@@ -616,6 +634,27 @@ int fit_image_hash_set_value (void *fit, int noffset, uint8_t *value,
 				int value_len);
 
 int fit_image_check_hashes (const void *fit, int noffset);
+
+/* hashes of one component image, computed as its data is read */
+struct fit_hash_stream {
+	int			count;
+	struct {
+		int		noffset;	/* hash node */
+		const char	*algo;
+		union {
+			uint32_t		crc32;
+			sha1_context		sha1;
+			struct MD5Context	md5;
+		} ctx;
+	} hash[FIT_MAX_HASHES];
+};
+
+int fit_image_hash_stream_start (const void *fit, int image_noffset,
+				struct fit_hash_stream *hs);
+void fit_image_hash_stream_update (struct fit_hash_stream *hs,
+				const void *data, size_t len);
+int fit_image_hash_stream_check (const void *fit, int image_noffset,
+				struct fit_hash_stream *hs);
 int fit_all_image_check_hashes (const void *fit);
 int fit_image_check_os (const void *fit, int noffset, uint8_t os);
 int fit_image_check_arch (const void *fit, int noffset, uint8_t arch);
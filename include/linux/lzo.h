@@ -31,6 +31,11 @@ int lzo1x_decompress_safe(const unsigned char *src, size_t src_len,
 int lzop_decompress(const unsigned char *src, size_t src_len,
 		    unsigned char *dst, size_t *dst_len);
 
+/* decompress lzop format pulled from a zsource */
+struct zsource;
+int lzop_decompress_stream(struct zsource *src, unsigned char *dst,
+			   size_t *dst_len);
+
 /*
  * Return values (< 0 = Error)
  */
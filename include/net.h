@@ -104,7 +104,10 @@ struct eth_device {
 	int  (*recv) (struct eth_device*);
 	void (*halt) (struct eth_device*);
 #ifdef CONFIG_MCAST_TFTP
-	int (*mcast) (struct eth_device*, u32 ip, u8 set);
+	int (*mcast) (struct eth_device*, const u8 *enetaddr, u8 set);
+#endif
+#ifdef CONFIG_NET_RX_FILTER
+	void (*rx_filter) (struct eth_device*, int flags);
 #endif
 	struct eth_device *next;
 	void *priv;
@@ -139,6 +142,17 @@ int eth_mcast_join( IPaddr_t mcast_addr, u8 join);
 u32 ether_crc (size_t len, unsigned char const *p);
 #endif
 
+#ifdef CONFIG_NET_RX_FILTER
+/*
+ * Frames the net core needs to see besides those sent to its own unicast
+ * address (and any multicast groups joined with eth_mcast_join()).  A device
+ * with a hardware address filter may drop everything else.
+ */
+#define NET_RX_BCAST	0x01	/* broadcast frames */
+
+void eth_rx_filter(int flags);
+#endif
+
 
 /**********************************************************************/
 /*
@@ -183,6 +197,7 @@ typedef struct {
 #define PROT_VLAN	0x8100		/* IEEE 802.1q protocol		*/
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -357,7 +372,7 @@ extern int		NetState;		/* Network loop state		*/
 extern int		NetRestartWrap;		/* Tried all network devices	*/
 #endif
 
-typedef enum { BOOTP, RARP, ARP, TFTP, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP } proto_t;
+typedef enum { BOOTP, RARP, ARP, TFTP, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP, WGET } proto_t;
 
 /* from net/net.c */
 extern char	BootFile[128];			/* Boot File name		*/
@@ -382,8 +397,17 @@ extern IPaddr_t	NetNtpServerIP;			/* the ip address to NTP	*/
 extern int NetTimeOffset;			/* offset time from UTC		*/
 #endif
 
+#if defined(CONFIG_SPI_FLASH_STREAM)
+/* when set, TFTP and wget write to this instead of load_addr */
+struct spi_flash_stream;
+extern struct spi_flash_stream *NetFlashStream;
+#endif
+
 /* Initialize the network adapter */
 extern int	NetLoop(proto_t);
+#ifdef CONFIG_NET_RX_FILTER
+extern void	NetRxFilterUpdate(void);	/* Pass our needs to eth_rx_filter() */
+#endif
 
 /* Shutdown adapters and cleanup */
 extern void	NetStop(void);
@@ -399,6 +423,7 @@ extern int	NetSetEther(volatile uchar *, uchar *, uint);
 
 /* Set IP header */
 extern void	NetSetIP(volatile uchar *, IPaddr_t, int, int, int);
+extern void	NetSetIPHeader(volatile uchar *, IPaddr_t, int, int);
 
 /* Checksum */
 extern int	NetCksumOk(uchar *, int);	/* Return true if cksum OK	*/
@@ -414,6 +439,9 @@ extern void	NetSendPacket(volatile uchar *, int);
 /* Transmit UDP packet, performing ARP request if needed */
 extern int	NetSendUDPPacket(uchar *ether, IPaddr_t dest, int dport, int sport, int len);
 
+/* Transmit IP packet of protocol proto, performing ARP request if needed */
+extern int	NetSendIPPacket(uchar *ether, IPaddr_t dest, int proto, int len);
+
 /* Processes a received packet */
 extern void	NetReceive(volatile uchar *, int);
 
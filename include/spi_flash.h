@@ -37,6 +37,13 @@ struct spi_flash {
 	const char	*name;
 
 	u32		size;
+	/*
+	 * Program and erase units for the JEDEC page program (0x02) and
+	 * sector erase (0xd8) commands, 0 if the part uses others.  The
+	 * flash stream below needs both.
+	 */
+	u32		page_size;
+	u32		sector_size;
 
 	int		(*read)(struct spi_flash *flash, u32 offset,
 				size_t len, void *buf);
@@ -54,6 +61,50 @@ struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs,
 		unsigned int max_hz, unsigned int spi_mode);
 void spi_flash_free(struct spi_flash *flash);
 
+struct zsource;
+int spi_flash_zsource(struct spi_flash *flash, u32 offset, u32 len,
+		struct zsource *src);
+
+#ifndef CONFIG_SF_STREAM_BUFFER
+#define CONFIG_SF_STREAM_BUFFER	0x10000	/* bytes buffered for programming */
+#endif
+
+/*
+ * A flash stream programs data appended in order at offset, offset + 1,
+ * ... without waiting for each erase or page program to finish: the
+ * data is buffered, and every call starts the next operation as soon as
+ * the flash is idle.  Sectors are erased as the data reaches them, or
+ * ahead of it up to offset + len when a length is given, so the flash
+ * is never erased past what the caller allowed.
+ */
+struct spi_flash_stream {
+	struct spi_flash *flash;
+	u32		base;		/* flash offset of the stream */
+	u32		end;		/* stream may not go past this */
+	u32		ahead;		/* erase ahead of the data up to here */
+	u32		pos;		/* flash offset of the next byte added */
+	u32		prog;		/* flash offset of the next byte to program */
+	u32		erased;		/* flash from prog up to here is erased */
+
+	u8		*ring;		/* bytes [prog, pos) */
+	size_t		ring_size;
+	size_t		tail;		/* ring index of the byte at prog */
+	u8		*page;		/* bounce buffer for a page split by the ring */
+
+	int		busy;		/* an erase or program is running */
+	ulong		op_start;
+	ulong		op_timeout;
+};
+
+int spi_flash_stream_init(struct spi_flash_stream *s, struct spi_flash *flash,
+		u32 offset, u32 len);
+int spi_flash_stream_write(struct spi_flash_stream *s, u32 offset,
+		const void *buf, size_t len);
+int spi_flash_stream_reserve(struct spi_flash_stream *s, size_t len);
+int spi_flash_stream_finish(struct spi_flash_stream *s);
+void spi_flash_stream_rewind(struct spi_flash_stream *s);
+void spi_flash_stream_end(struct spi_flash_stream *s);
+
 static inline int spi_flash_read(struct spi_flash *flash, u32 offset,
 		size_t len, void *buf)
 {
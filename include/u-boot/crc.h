@@ -29,5 +29,7 @@
 uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
+uint32_t memcpy_crc32 (uint32_t, void *, const void *, uint);
+uint32_t memcpy_crc32_wd (uint32_t, void *, const void *, uint, uint);
 
 #endif /* _UBOOT_CRC_H */
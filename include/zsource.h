@@ -0,0 +1,81 @@
+/*
+ * Streaming input for the decompressors
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef _ZSOURCE_H_
+#define _ZSOURCE_H_
+
+#include <linux/types.h>
+
+#ifndef CONFIG_ZSOURCE_CHUNK
+#define CONFIG_ZSOURCE_CHUNK	0x8000	/* bytes fetched per read() */
+#endif
+
+/*
+ * A zsource feeds compressed data to gunzip_stream(),
+ * lzop_decompress_stream() and lzmaStreamDecompress() one chunk at a
+ * time, so an image on a device that is not memory mapped can be
+ * decompressed straight to its load address without staging all of it
+ * in RAM first.
+ *
+ * A provider fills in read(), close(), priv, base and len and then calls
+ * zsource_init().  The user may then set crc_on or digest(); everything
+ * else belongs to lib/zsource.c.
+ */
+struct zsource {
+	const char	*name;		/* for messages */
+
+	/* read len bytes from device address addr into buf, 0 on success */
+	int		(*read)(struct zsource *src, ulong addr, size_t len,
+				void *buf);
+	/* release the device, may be NULL */
+	void		(*close)(struct zsource *src);
+	void		*priv;
+
+	ulong		base;		/* device address of the stream */
+	ulong		len;		/* stream length in bytes */
+	ulong		pos;		/* bytes fetched from the device */
+
+	int		crc_on;		/* keep a crc32 of the fetched data */
+	uint32_t	crc;
+
+	/* called with the data as it is fetched, may be NULL */
+	void		(*digest)(struct zsource *src, const void *data,
+				  size_t len);
+	void		*digest_priv;
+
+	uchar		*buf;		/* chunk buffer */
+	uchar		*head;		/* next unconsumed byte in buf */
+	size_t		avail;		/* unconsumed bytes in buf */
+};
+
+int zsource_init(struct zsource *src);
+void zsource_end(struct zsource *src);
+int zsource_peek(struct zsource *src, const uchar **data);
+void zsource_skip(struct zsource *src, size_t len);
+int zsource_read(struct zsource *src, void *dst, size_t len);
+int zsource_finish(struct zsource *src);
+
+/* lib/gunzip.c */
+int gunzip_stream(void *dst, int dstlen, struct zsource *src,
+		  unsigned long *lenp);
+
+#endif /* _ZSOURCE_H_ */
@@ -149,6 +149,37 @@ tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
 
+#ifdef CONFIG_CRC32_SLICING
+/* =========================================================================
+ * Slicing-by-4/8: t[k][n] is the CRC of byte n followed by k zero bytes,
+ * so 4 (or 8) input bytes are folded in with one lookup each and no
+ * dependency between the lookups.  The tables are derived from crc_table
+ * at first use and kept in the same (little endian) byte order.
+ */
+#if (CONFIG_CRC32_SLICING != 4) && (CONFIG_CRC32_SLICING != 8)
+# error "CONFIG_CRC32_SLICING must be 4 or 8"
+#endif
+
+local int crc_slice_empty = 1;
+local uint32_t crc_slice_table[CONFIG_CRC32_SLICING][256];
+
+local void make_crc_slice_table(void)
+{
+  uint32_t c;
+  int n, k;
+
+  for (n = 0; n < 256; n++) {
+    c = le32_to_cpu(crc_table[n]);
+    crc_slice_table[0][n] = tole(c);
+    for (k = 1; k < CONFIG_CRC32_SLICING; k++) {
+      c = le32_to_cpu(crc_table[c & 0xff]) ^ (c >> 8);
+      crc_slice_table[k][n] = tole(c);
+    }
+  }
+  crc_slice_empty = 0;
+}
+#endif /* CONFIG_CRC32_SLICING */
+
 #if 0
 /* =========================================================================
  * This function can be used by asm versions of crc32()
@@ -169,6 +200,29 @@ const uint32_t * ZEXPORT get_crc_table()
 #  define DO_CRC(x) crc = tab[((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
 # endif
 
+#ifdef CONFIG_CRC32_SLICING
+# define T(k, x)	crc_slice_table[k][(x) & 255]
+# if __BYTE_ORDER == __LITTLE_ENDIAN
+#  define DO_CRC4(c) \
+	(c) = T(3, c) ^ T(2, (c) >> 8) ^ T(1, (c) >> 16) ^ T(0, (c) >> 24)
+#  define DO_CRC8(one, two) \
+	crc = T(7, one) ^ T(6, (one) >> 8) ^ T(5, (one) >> 16) ^ \
+	      T(4, (one) >> 24) ^ T(3, two) ^ T(2, (two) >> 8) ^ \
+	      T(1, (two) >> 16) ^ T(0, (two) >> 24)
+# else
+#  define DO_CRC4(c) \
+	(c) = T(0, c) ^ T(1, (c) >> 8) ^ T(2, (c) >> 16) ^ T(3, (c) >> 24)
+#  define DO_CRC8(one, two) \
+	crc = T(4, one) ^ T(5, (one) >> 8) ^ T(6, (one) >> 16) ^ \
+	      T(7, (one) >> 24) ^ T(0, two) ^ T(1, (two) >> 8) ^ \
+	      T(2, (two) >> 16) ^ T(3, (two) >> 24)
+# endif
+/* tools/crc32_test supplies big-endian loads to run the BE path */
+# ifndef CRC_WORD
+#  define CRC_WORD(p)	(*(p))
+# endif
+#endif
+
 /* ========================================================================= */
 
 /* No ones complement version. JFFS2 (and other things ?)
@@ -195,6 +249,22 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 
     rem_len = len & 3;
     len = len >> 2;
+#ifdef CONFIG_CRC32_SLICING
+    if (crc_slice_empty)
+      make_crc_slice_table();
+# if CONFIG_CRC32_SLICING == 8
+    for (; len >= 2; len -= 2) {
+	 uint32_t one = CRC_WORD(b++) ^ crc;
+	 uint32_t two = CRC_WORD(b++);
+	 DO_CRC8(one, two);
+    }
+# endif
+    for (; len; --len) {
+	 crc ^= CRC_WORD(b++);
+	 DO_CRC4(crc);
+    }
+    --b;
+#else
     for (--b; len; --len) {
 	 /* load data 32 bits wide, xor data 32 bits wide. */
 	 crc ^= *++b; /* use pre increment for speed */
@@ -203,6 +273,7 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 	 DO_CRC(0);
 	 DO_CRC(0);
     }
+#endif
     len = rem_len;
     /* And the last few bytes */
     if (len) {
@@ -215,6 +286,12 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     return le32_to_cpu(crc);
 }
 #undef DO_CRC
+#ifdef CONFIG_CRC32_SLICING
+# undef DO_CRC4
+# undef DO_CRC8
+# undef T
+# undef CRC_WORD
+#endif
 
 uint32_t ZEXPORT crc32 (uint32_t crc, const Bytef *p, uInt len)
 {
@@ -249,3 +326,60 @@ uint32_t ZEXPORT crc32_wd (uint32_t crc,
 
 	return crc;
 }
+
+/*
+ * Copy 'len' bytes from 'src' to 'dst' and return the crc32 of the data,
+ * in a single pass over the source.  The data is processed in blocks small
+ * enough to stay in the data cache: each block is checksummed and then
+ * copied, so the copy reads the source from the cache instead of memory.
+ * Checksumming ahead of the copy also keeps the result correct when the
+ * destination overlaps the start of the source (dst <= src).
+ */
+#ifndef CRC32_COPY_BLOCK
+#define CRC32_COPY_BLOCK	2048
+#endif
+
+uint32_t ZEXPORT memcpy_crc32 (uint32_t crc, void *dst,
+			       const void *src, uInt len)
+{
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	uInt chunk;
+
+	while (len) {
+		chunk = (len > CRC32_COPY_BLOCK) ? CRC32_COPY_BLOCK : len;
+		crc = crc32 (crc, s, chunk);
+		memmove (d, s, chunk);
+		d += chunk;
+		s += chunk;
+		len -= chunk;
+	}
+
+	return crc;
+}
+
+/*
+ * As memcpy_crc32(), triggering the watchdog every 'chunk_sz' bytes.
+ */
+uint32_t ZEXPORT memcpy_crc32_wd (uint32_t crc, void *dst,
+				  const void *src, uInt len, uInt chunk_sz)
+{
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	uInt chunk;
+
+	while (len) {
+		chunk = (len > chunk_sz) ? chunk_sz : len;
+		crc = memcpy_crc32 (crc, d, s, chunk);
+		d += chunk;
+		s += chunk;
+		len -= chunk;
+		WATCHDOG_RESET ();
+	}
+#else
+	crc = memcpy_crc32 (crc, dst, src, len);
+#endif
+
+	return crc;
+}
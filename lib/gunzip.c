@@ -27,6 +27,7 @@
 #include <image.h>
 #include <malloc.h>
 #include <u-boot/zlib.h>
+#include <zsource.h>
 
 #define	ZALLOC_ALIGNMENT	16
 #define HEAD_CRC		2
@@ -56,7 +57,11 @@ void zfree(void *x, void *addr, unsigned nb)
 	free (addr);
 }
 
-int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+/*
+ * Return the length of the gzip header at src, or -1 if it is bad or does
+ * not fit in the len bytes available.
+ */
+static int gunzip_header_len(const unsigned char *src, unsigned long len)
 {
 	int i, flags;
 
@@ -70,18 +75,29 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	if ((flags & EXTRA_FIELD) != 0)
 		i = 12 + src[10] + (src[11] << 8);
 	if ((flags & ORIG_NAME) != 0)
-		while (src[i++] != 0)
+		while (i < len && src[i++] != 0)
 			;
 	if ((flags & COMMENT) != 0)
-		while (src[i++] != 0)
+		while (i < len && src[i++] != 0)
 			;
 	if ((flags & HEAD_CRC) != 0)
 		i += 2;
-	if (i >= *lenp) {
+	if (i >= len) {
 		puts ("Error: gunzip out of data in header\n");
 		return (-1);
 	}
 
+	return i;
+}
+
+int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+{
+	int i;
+
+	i = gunzip_header_len(src, *lenp);
+	if (i < 0)
+		return (-1);
+
 	return zunzip(dst, dstlen, src, lenp, 1, i);
 }
 
@@ -122,3 +138,70 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return 0;
 }
+
+#ifdef CONFIG_ZSOURCE
+/*
+ * gunzip_stream - gunzip from a zsource
+ *
+ * Like gunzip(), but the compressed data is pulled from src a chunk at a
+ * time and inflated as it arrives.  *lenp is set to the number of bytes
+ * written to dst.
+ */
+int gunzip_stream(void *dst, int dstlen, struct zsource *src,
+		  unsigned long *lenp)
+{
+	const unsigned char *data;
+	z_stream s;
+	int len, i, r;
+
+	len = zsource_peek(src, &data);
+	if (len < 10) {
+		puts ("Error: gunzip out of data in header\n");
+		return (-1);
+	}
+	i = gunzip_header_len(data, len);
+	if (i < 0)
+		return (-1);
+	zsource_skip(src, i);
+
+	s.zalloc = zalloc;
+	s.zfree = zfree;
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+	s.outcb = (cb_func)WATCHDOG_RESET;
+#else
+	s.outcb = Z_NULL;
+#endif	/* CONFIG_HW_WATCHDOG */
+
+	r = inflateInit2(&s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf ("Error: inflateInit2() returned %d\n", r);
+		return -1;
+	}
+	s.next_out = dst;
+	s.avail_out = dstlen;
+
+	do {
+		len = zsource_peek(src, &data);
+		if (len <= 0) {
+			puts ("Error: gunzip out of data\n");
+			r = Z_DATA_ERROR;
+			break;
+		}
+		s.next_in = (unsigned char *)data;
+		s.avail_in = len;
+
+		r = inflate(&s, Z_NO_FLUSH);
+		zsource_skip(src, len - s.avail_in);
+	} while (r == Z_OK);
+
+	*lenp = s.next_out - (unsigned char *) dst;
+	inflateEnd(&s);
+
+	if (r != Z_STREAM_END) {
+		printf ("Error: inflate() returned %d\n", r);
+		return (-1);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_ZSOURCE */
@@ -49,6 +49,7 @@
 
 #include <linux/string.h>
 #include <malloc.h>
+#include <zsource.h>
 
 static void *SzAlloc(void *p, size_t size) { p = p; return malloc(size); }
 static void SzFree(void *p, void *address) { p = p; free(address); }
@@ -130,4 +131,78 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     return res;
 }
 
+#ifdef CONFIG_ZSOURCE
+/*
+ * Same as lzmaBuffToBuffDecompress(), but the compressed data is pulled
+ * from src a chunk at a time.  *uncompressedSize holds the room available
+ * at outStream on entry and the number of bytes written on return.
+ */
+int lzmaStreamDecompress (unsigned char *outStream, SizeT *uncompressedSize,
+                          struct zsource *src)
+{
+    unsigned char header[LZMA_DATA_OFFSET];
+    const unsigned char *data;
+    ISzAlloc g_Alloc;
+    CLzmaDec dec;
+    ELzmaStatus state;
+    SizeT outSize = *uncompressedSize;
+    SizeT inSize;
+    UInt32 sizeLow = 0, sizeHigh = 0;
+    int res, i, len;
+
+    *uncompressedSize = 0;
+    if (zsource_read(src, header, sizeof(header)))
+        return SZ_ERROR_INPUT_EOF;
+
+    for (i = 0; i < 4; i++) {
+        sizeLow |= (UInt32)header[LZMA_SIZE_OFFSET + i] << (i * 8);
+        sizeHigh |= (UInt32)header[LZMA_SIZE_OFFSET + 4 + i] << (i * 8);
+    }
+
+    /* all ones is "unknown size": decode up to the end mark */
+    if (sizeHigh != (UInt32)-1 || sizeLow != (UInt32)-1) {
+        if (sizeHigh != 0 || sizeLow > outSize) {
+            debug ("LZMA: image does not fit in 0x%lx bytes\n", outSize);
+            return SZ_ERROR_OUTPUT_EOF;
+        }
+        outSize = sizeLow;
+    }
+
+    g_Alloc.Alloc = SzAlloc;
+    g_Alloc.Free = SzFree;
+
+    LzmaDec_Construct(&dec);
+    res = LzmaDec_AllocateProbs(&dec, header, LZMA_PROPS_SIZE, &g_Alloc);
+    if (res != SZ_OK)
+        return res;
+    dec.dic = outStream;
+    dec.dicBufSize = outSize;
+    LzmaDec_Init(&dec);
+
+    do {
+        len = zsource_peek(src, &data);
+        if (len < 0) {
+            res = SZ_ERROR_READ;
+            break;
+        }
+
+        WATCHDOG_RESET();
+
+        inSize = len;
+        res = LzmaDec_DecodeToDic(&dec, outSize, data, &inSize,
+                                  LZMA_FINISH_ANY, &state);
+        zsource_skip(src, inSize);
+
+        if (res == SZ_OK && state == LZMA_STATUS_NEEDS_MORE_INPUT &&
+            len == 0)
+            res = SZ_ERROR_INPUT_EOF;
+    } while (res == SZ_OK && state == LZMA_STATUS_NEEDS_MORE_INPUT);
+
+    *uncompressedSize = dec.dicPos;
+    LzmaDec_FreeProbs(&dec, &g_Alloc);
+
+    return res;
+}
+#endif /* CONFIG_ZSOURCE */
+
 #endif
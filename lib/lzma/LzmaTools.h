@@ -32,4 +32,8 @@
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+struct zsource;
+extern int lzmaStreamDecompress (unsigned char *outStream, SizeT *uncompressedSize,
+			      struct zsource *src);
 #endif
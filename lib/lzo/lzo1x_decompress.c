@@ -15,6 +15,8 @@
 #include <linux/lzo.h>
 #include <asm/byteorder.h>
 #include <asm/unaligned.h>
+#include <malloc.h>
+#include <zsource.h>
 #include "lzodefs.h"
 
 #define HAVE_IP(x, ip_end, ip) ((size_t)(ip_end - ip) < (x))
@@ -111,6 +113,112 @@ int lzop_decompress(const unsigned char *src, size_t src_len,
 	return LZO_E_INPUT_OVERRUN;
 }
 
+#ifdef CONFIG_ZSOURCE
+/*
+ * Longest lzop header parse_header() can walk over: magic, version
+ * fields, method, level, flags, filter, mode, mtime, a 255 byte name
+ * and the header checksum.
+ */
+#define LZOP_MAX_HEADER		(9 + 7 + 1 + 4 + 4 + 4 + 8 + 1 + 255 + 4)
+
+/*
+ * lzop_decompress_stream - lzop_decompress() from a zsource
+ *
+ * Each block is read from src on its own and decompressed before the next
+ * one is fetched.  Blocks lzop stored uncompressed are read straight into
+ * dst.
+ */
+int lzop_decompress_stream(struct zsource *src, unsigned char *dst,
+			   size_t *dst_len)
+{
+	unsigned char *start = dst;
+	unsigned char *dend = dst + *dst_len;
+	unsigned char *blk = NULL;
+	const unsigned char *hdr, *data;
+	u8 info[12];
+	u32 slen, dlen, blk_size = 0;
+	size_t tmp;
+	int len, r;
+
+	len = zsource_peek(src, &data);
+	if (len < LZOP_MAX_HEADER && len < src->len)
+		return LZO_E_ERROR;
+	hdr = parse_header(data);
+	if (!hdr || hdr - data > len)
+		return LZO_E_ERROR;
+	zsource_skip(src, hdr - data);
+
+	for (;;) {
+		/* read uncompressed block size */
+		if (zsource_read(src, info, 4)) {
+			r = LZO_E_INPUT_OVERRUN;
+			break;
+		}
+		dlen = get_unaligned_be32(info);
+
+		/* exit if last block */
+		if (dlen == 0) {
+			*dst_len = dst - start;
+			r = LZO_E_OK;
+			break;
+		}
+
+		/* read compressed block size, and skip block checksum info */
+		if (zsource_read(src, info + 4, 8)) {
+			r = LZO_E_INPUT_OVERRUN;
+			break;
+		}
+		slen = get_unaligned_be32(info + 4);
+
+		if (slen <= 0 || slen > dlen) {
+			r = LZO_E_ERROR;
+			break;
+		}
+		if (dlen > dend - dst) {
+			r = LZO_E_OUTPUT_OVERRUN;
+			break;
+		}
+
+		if (slen == dlen) {
+			/* stored block */
+			if (zsource_read(src, dst, dlen)) {
+				r = LZO_E_INPUT_OVERRUN;
+				break;
+			}
+		} else {
+			if (slen > blk_size) {
+				free(blk);
+				blk = malloc(slen);
+				if (!blk) {
+					r = LZO_E_OUT_OF_MEMORY;
+					break;
+				}
+				blk_size = slen;
+			}
+			if (zsource_read(src, blk, slen)) {
+				r = LZO_E_INPUT_OVERRUN;
+				break;
+			}
+
+			/* decompress */
+			tmp = dlen;
+			r = lzo1x_decompress_safe(blk, slen, dst, &tmp);
+			if (r != LZO_E_OK)
+				break;
+			if (dlen != tmp) {
+				r = LZO_E_ERROR;
+				break;
+			}
+		}
+
+		dst += dlen;
+	}
+
+	free(blk);
+	return r;
+}
+#endif /* CONFIG_ZSOURCE */
+
 int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 			unsigned char *out, size_t *out_len)
 {
@@ -27,7 +27,9 @@
 #define ZLIB_INTERNAL
 
 #include "u-boot/zlib.h"
+#ifndef USE_HOSTCC	/* tools/zlib_bench builds this file on the host */
 #include <common.h>
+#endif
 #undef	OFF				/* avoid conflicts */
 
 /* To avoid a build time warning */
@@ -403,6 +405,75 @@ void inflate_fast OF((z_streamp strm, unsigned start));
 #define OFF 1
 #define PUP(a) *++(a)
 
+#ifdef CONFIG_ZLIB_INFLATE_FAST
+/*
+ * U-Boot: inflate_fast() refills the bit buffer to at least 24 bits at
+ * the top of the loop, which can read one byte more per iteration, so it
+ * needs one more byte of input to be available.
+ */
+#define INFLATE_FAST_IN 6
+
+/*
+   Copy a match of len bytes from dist = out - from bytes back in the
+   output.  The regions overlap when dist < len, which rules out a plain
+   memcpy(); but when dist is at least the access size every word (or
+   halfword) read has been completely written already, so the copy can
+   still go a word at a time when the pointers share their alignment.
+   dist == 1 is a run of a single byte value.  Returns the updated out.
+ */
+local unsigned char FAR *inflate_copy OF((unsigned char FAR *out,
+                                          const unsigned char FAR *from,
+                                          unsigned len));
+
+local unsigned char FAR *inflate_copy(out, from, len)
+unsigned char FAR *out;
+const unsigned char FAR *from;
+unsigned len;
+{
+    unsigned dist = (unsigned)(out - from);
+
+    if (len >= 8) {
+        if (dist >= len) {
+            zmemcpy(out, from, len);
+            return out + len;
+        }
+        if (dist == 1) {
+            memset(out, *from, len);
+            return out + len;
+        }
+        if (dist >= 4 && (((unsigned long)out ^ (unsigned long)from) & 3) == 0) {
+            while ((unsigned long)out & 3) {
+                *out++ = *from++;
+                len--;
+            }
+            do {
+                *(u32 *)out = *(const u32 *)from;
+                out += 4;
+                from += 4;
+                len -= 4;
+            } while (len >= 4);
+        }
+        else if (dist >= 2 && (((unsigned long)out ^ (unsigned long)from) & 1) == 0) {
+            if ((unsigned long)out & 1) {
+                *out++ = *from++;
+                len--;
+            }
+            do {
+                *(u16 *)out = *(const u16 *)from;
+                out += 2;
+                from += 2;
+                len -= 2;
+            } while (len >= 2);
+        }
+    }
+    while (len--)
+        *out++ = *from++;
+    return out;
+}
+#else
+#define INFLATE_FAST_IN 5
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -471,7 +542,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
+    last = in + (strm->avail_in - INFLATE_FAST_IN);
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
     end = out + (strm->avail_out - 257);
@@ -497,6 +568,13 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
             bits += 8;
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
+#ifdef CONFIG_ZLIB_INFLATE_FAST
+            /* enough for any length code and its extra bits */
+            if (bits < 24) {
+                hold += (unsigned long)(PUP(in)) << bits;
+                bits += 8;
+            }
+#endif
         }
         this = lcode[hold & lmask];
       dolen:
@@ -605,6 +683,9 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                             from = out - dist;  /* rest from output */
                         }
                     }
+#ifdef CONFIG_ZLIB_INFLATE_FAST
+                    out = inflate_copy(out + OFF, from + OFF, len) - OFF;
+#else
                     while (len > 2) {
                         PUP(out) = PUP(from);
                         PUP(out) = PUP(from);
@@ -616,9 +697,13 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         if (len > 1)
                             PUP(out) = PUP(from);
                     }
+#endif
                 }
                 else {
                     from = out - dist;          /* copy direct from output */
+#ifdef CONFIG_ZLIB_INFLATE_FAST
+                    out = inflate_copy(out + OFF, from + OFF, len) - OFF;
+#else
                     do {                        /* minimum length is three */
                         PUP(out) = PUP(from);
                         PUP(out) = PUP(from);
@@ -630,6 +715,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         if (len > 1)
                             PUP(out) = PUP(from);
                     }
+#endif
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -667,7 +753,8 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* update state and return */
     strm->next_in = in + OFF;
     strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ? INFLATE_FAST_IN + (last - in) :
+                                 INFLATE_FAST_IN - (in - last));
     strm->avail_out = (unsigned)(out < end ?
                                  257 + (end - out) : 257 - (out - end));
     state->hold = hold;
@@ -1746,7 +1833,7 @@ int flush;
         case LEN:
             if (strm->outcb != Z_NULL) /* for watchdog (U-Boot) */
                 (*strm->outcb)(Z_NULL, 0);
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_IN + 1 && left >= 258) {
                 RESTORE();
                 inflate_fast(strm, out);
                 LOAD();
@@ -0,0 +1,142 @@
+/*
+ * Streaming input for the decompressors
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <zsource.h>
+#include <u-boot/crc.h>
+
+/* Fetch the next len bytes of the stream from the device into buf */
+static int zsource_fetch(struct zsource *src, void *buf, size_t len)
+{
+	if (len > src->len - src->pos)
+		return -1;
+
+	WATCHDOG_RESET();
+	if (src->read(src, src->base + src->pos, len, buf))
+		return -1;
+
+	if (src->crc_on)
+		src->crc = crc32(src->crc, buf, len);
+	if (src->digest)
+		src->digest(src, buf, len);
+	src->pos += len;
+
+	return 0;
+}
+
+int zsource_init(struct zsource *src)
+{
+	src->pos = 0;
+	src->crc_on = 0;
+	src->crc = 0;
+	src->digest = NULL;
+	src->avail = 0;
+
+	src->buf = malloc(CONFIG_ZSOURCE_CHUNK);
+	if (!src->buf) {
+		puts("zsource: out of memory\n");
+		return -1;
+	}
+	src->head = src->buf;
+
+	return 0;
+}
+
+void zsource_end(struct zsource *src)
+{
+	free(src->buf);
+	src->buf = NULL;
+	src->avail = 0;
+
+	if (src->close)
+		src->close(src);
+}
+
+/*
+ * Return the buffered bytes, refilling the buffer first if it is empty.
+ * The bytes are not consumed until zsource_skip() is called.
+ *
+ * returns:
+ *     number of bytes at *data, 0 at the end of the stream, -1 on error
+ */
+int zsource_peek(struct zsource *src, const uchar **data)
+{
+	size_t len;
+
+	if (!src->avail) {
+		len = min(src->len - src->pos, (ulong)CONFIG_ZSOURCE_CHUNK);
+		if (len && zsource_fetch(src, src->buf, len))
+			return -1;
+
+		src->head = src->buf;
+		src->avail = len;
+	}
+
+	*data = src->head;
+	return src->avail;
+}
+
+void zsource_skip(struct zsource *src, size_t len)
+{
+	if (len > src->avail)
+		len = src->avail;
+
+	src->head += len;
+	src->avail -= len;
+}
+
+/*
+ * Copy exactly len bytes to dst.  Whatever is not already buffered is read
+ * from the device straight into dst.
+ *
+ * returns:
+ *     0 on success, -1 on a read error or if the stream is too short
+ */
+int zsource_read(struct zsource *src, void *dst, size_t len)
+{
+	size_t n = min(len, src->avail);
+
+	memcpy(dst, src->head, n);
+	zsource_skip(src, n);
+
+	if (len == n)
+		return 0;
+
+	return zsource_fetch(src, (uchar *)dst + n, len - n);
+}
+
+/*
+ * Read and discard the rest of the stream, so that the crc covers all of
+ * it even when the decompressor stopped short of the end.
+ */
+int zsource_finish(struct zsource *src)
+{
+	const uchar *data;
+	int len;
+
+	while ((len = zsource_peek(src, &data)) > 0)
+		zsource_skip(src, len);
+
+	return len;
+}
@@ -269,6 +269,15 @@ int eth_initialize(bd_t *bis)
 	return eth_number;
 }
 
+#ifdef CONFIG_NET_RX_FILTER
+/* Pass the net core's receive needs (NET_RX_xxx) to the device's filter */
+void eth_rx_filter(int flags)
+{
+	if (eth_current && eth_current->rx_filter)
+		eth_current->rx_filter(eth_current, flags);
+}
+#endif
+
 #ifdef CONFIG_MCAST_TFTP
 /* Multicast.
  * mcast_addr: multicast ipaddr from which multicast Mac is made
@@ -94,6 +94,10 @@
 #if defined(CONFIG_CMD_DNS)
 #include "dns.h"
 #endif
+#if defined(CONFIG_CMD_WGET)
+#include "tcp.h"
+#include "wget.h"
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -177,6 +181,10 @@ IPaddr_t	NetNtpServerIP;		/* NTP server IP address		*/
 int		NetTimeOffset=0;	/* offset time from UTC			*/
 #endif
 
+#ifdef CONFIG_SPI_FLASH_STREAM
+struct spi_flash_stream *NetFlashStream;
+#endif
+
 #ifdef CONFIG_NETCONSOLE
 void NcStart(void);
 int nc_input_packet(uchar *pkt, unsigned dest, unsigned src, unsigned len);
@@ -247,6 +255,9 @@ void ArpRequest (void)
 
 	NetWriteIP ((uchar *) & arp->ar_data[16], NetArpWaitReplyIP);
 	(void) eth_send (NetTxPacket, (pkt - NetTxPacket) + ARP_HDR_SIZE);
+#ifdef CONFIG_NET_RX_FILTER
+	NetRxFilterUpdate();
+#endif
 }
 
 void ArpTimeoutCheck(void)
@@ -273,6 +284,38 @@ void ArpTimeoutCheck(void)
 	}
 }
 
+#ifdef CONFIG_NET_RX_FILTER
+static proto_t NetRxFilterProtocol;
+
+/*
+ * Ask the Ethernet device to receive only what the current protocol needs:
+ * broadcasts are dropped in hardware while a protocol that talks to its
+ * peer by unicast alone runs, except when an ARP request is outstanding.
+ */
+void NetRxFilterUpdate(void)
+{
+	int flags = 0;
+
+	switch (NetRxFilterProtocol) {
+	case TFTP:
+	case PING:
+	case DNS:
+	case NFS:
+	case SNTP:
+	case WGET:
+		break;
+	default:
+		flags |= NET_RX_BCAST;
+		break;
+	}
+
+	if (NetArpWaitPacketIP)
+		flags |= NET_RX_BCAST;
+
+	eth_rx_filter(flags);
+}
+#endif
+
 static void
 NetInitLoop(proto_t protocol)
 {
@@ -363,6 +406,10 @@ restart:
 	 *	packets and timer events.
 	 */
 	NetInitLoop(protocol);
+#ifdef CONFIG_NET_RX_FILTER
+	NetRxFilterProtocol = protocol;
+	NetRxFilterUpdate();
+#endif
 
 	switch (net_check_prereq (protocol)) {
 	case 1:
@@ -434,6 +481,11 @@ restart:
 		case DNS:
 			DnsStart();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			WgetStart();
+			break;
 #endif
 		default:
 			break;
@@ -535,7 +587,11 @@ restart:
                                 // header magic number, then this image is prepended with
                                 // a mkimage header, and we can check its checksum.
 				setenv("crcreturn", "1");
-				if(ntohl(*(uint32_t*)load_addr) == IH_MAGIC) {
+				if (
+#ifdef CONFIG_SPI_FLASH_STREAM
+				    !NetFlashStream &&	/* nothing at load_addr */
+#endif
+				    ntohl(*(uint32_t*)load_addr) == IH_MAGIC) {
 					printf("   Verifying Checksum ... ");
 					if(!image_check_hcrc((image_header_t*)load_addr) || !image_check_dcrc((image_header_t *)load_addr)) {
 						printf("Bad CRC - please reboot and retry\n");
@@ -552,8 +608,14 @@ restart:
 					}
 				}
 
-				sprintf(buf, "%lX", (unsigned long)load_addr);
-				setenv("fileaddr", buf);
+#ifdef CONFIG_SPI_FLASH_STREAM
+				/* the file went to flash, not to load_addr */
+				if (!NetFlashStream)
+#endif
+				{
+					sprintf(buf, "%lX", (unsigned long)load_addr);
+					setenv("fileaddr", buf);
+				}
 			}
 			eth_halt();
 			return NetBootFileXferSize;
@@ -706,6 +768,47 @@ NetSendUDPPacket(uchar *ether, IPaddr_t dest, int dport, int sport, int len)
 	return 0;	/* transmitted */
 }
 
+/*
+ * Like NetSendUDPPacket(), for the len bytes of protocol proto that the
+ * caller put after the bare IP header in NetTxPacket.
+ */
+int
+NetSendIPPacket(uchar *ether, IPaddr_t dest, int proto, int len)
+{
+	uchar *pkt;
+
+	/* if MAC address was not discovered yet, save the packet and do an ARP request */
+	if (memcmp(ether, NetEtherNullAddr, 6) == 0) {
+
+		debug("sending ARP for %08lx\n", dest);
+
+		NetArpWaitPacketIP = dest;
+		NetArpWaitPacketMAC = ether;
+
+		pkt = NetArpWaitTxPacket;
+		pkt += NetSetEther (pkt, NetArpWaitPacketMAC, PROT_IP);
+
+		NetSetIPHeader (pkt, dest, proto, len);
+		memcpy(pkt + IP_HDR_SIZE_NO_UDP, (uchar *)NetTxPacket + (pkt - (uchar *)NetArpWaitTxPacket) + IP_HDR_SIZE_NO_UDP, len);
+
+		/* size of the waiting packet */
+		NetArpWaitTxPacketSize = (pkt - NetArpWaitTxPacket) + IP_HDR_SIZE_NO_UDP + len;
+
+		/* and do the ARP request */
+		NetArpWaitTry = 1;
+		NetArpWaitTimerStart = get_timer(0);
+		ArpRequest();
+		return 1;	/* waiting */
+	}
+
+	pkt = (uchar *)NetTxPacket;
+	pkt += NetSetEther (pkt, ether, PROT_IP);
+	NetSetIPHeader (pkt, dest, proto, len);
+	(void) eth_send(NetTxPacket, (pkt - NetTxPacket) + IP_HDR_SIZE_NO_UDP + len);
+
+	return 0;	/* transmitted */
+}
+
 #if defined(CONFIG_CMD_PING)
 static ushort PingSeqNo;
 
@@ -1504,6 +1607,9 @@ NetReceive(volatile uchar * inpkt, int len)
 				NetArpWaitPacketIP = 0;
 				NetArpWaitTxPacketSize = 0;
 				NetArpWaitPacketMAC = NULL;
+#ifdef CONFIG_NET_RX_FILTER
+				NetRxFilterUpdate();
+#endif
 
 			}
 			return;
@@ -1637,6 +1743,11 @@ NetReceive(volatile uchar * inpkt, int len)
 			default:
 				return;
 			}
+		} else if (ip->ip_p == IPPROTO_TCP) {
+#if defined(CONFIG_CMD_WGET)
+			TcpReceive(ip, len);
+#endif
+			return;
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1731,6 +1842,11 @@ static int net_check_prereq (proto_t protocol)
 		}
 		goto common;
 #endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
+		/* the server may be given in the URL */
+		goto common;
+#endif
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
 #endif
@@ -1740,7 +1856,8 @@ static int net_check_prereq (proto_t protocol)
 			puts ("*** ERROR: `serverip' not set\n");
 			return (1);
 		}
-#if defined(CONFIG_CMD_PING) || defined(CONFIG_CMD_SNTP)
+#if defined(CONFIG_CMD_PING) || defined(CONFIG_CMD_SNTP) || \
+    defined(CONFIG_CMD_DNS) || defined(CONFIG_CMD_WGET)
     common:
 #endif
 
@@ -1845,6 +1962,25 @@ NetSetEther(volatile uchar * xet, uchar * addr, uint prot)
 	}
 }
 
+/* Set the bare IP header for len bytes of protocol proto */
+void
+NetSetIPHeader(volatile uchar * xip, IPaddr_t dest, int proto, int len)
+{
+	IP_t *ip = (IP_t *)xip;
+
+	ip->ip_hl_v  = 0x45;		/* IP_HDR_SIZE / 4 (not including UDP) */
+	ip->ip_tos   = 0;
+	ip->ip_len   = htons(IP_HDR_SIZE_NO_UDP + len);
+	ip->ip_id    = htons(NetIPID++);
+	ip->ip_off   = htons(IP_FLAGS_DFRAG);	/* Don't fragment */
+	ip->ip_ttl   = 255;
+	ip->ip_p     = proto;
+	ip->ip_sum   = 0;
+	NetCopyIP((void*)&ip->ip_src, &NetOurIP); /* already in network byte order */
+	NetCopyIP((void*)&ip->ip_dst, &dest);	   /* - "" - */
+	ip->ip_sum   = ~NetCksum((uchar *)ip, IP_HDR_SIZE_NO_UDP / 2);
+}
+
 void
 NetSetIP(volatile uchar * xip, IPaddr_t dest, int dport, int sport, int len)
 {
@@ -1862,21 +1998,11 @@ NetSetIP(volatile uchar * xip, IPaddr_t dest, int dport, int sport, int len)
 	 *	Construct an IP and UDP header.
 	 *	(need to set no fragment bit - XXX)
 	 */
-	ip->ip_hl_v  = 0x45;		/* IP_HDR_SIZE / 4 (not including UDP) */
-	ip->ip_tos   = 0;
-	ip->ip_len   = htons(IP_HDR_SIZE + len);
-	ip->ip_id    = htons(NetIPID++);
-	ip->ip_off   = htons(IP_FLAGS_DFRAG);	/* Don't fragment */
-	ip->ip_ttl   = 255;
-	ip->ip_p     = 17;		/* UDP */
-	ip->ip_sum   = 0;
-	NetCopyIP((void*)&ip->ip_src, &NetOurIP); /* already in network byte order */
-	NetCopyIP((void*)&ip->ip_dst, &dest);	   /* - "" - */
+	NetSetIPHeader(xip, dest, IPPROTO_UDP, 8 + len);
 	ip->udp_src  = htons(sport);
 	ip->udp_dst  = htons(dport);
 	ip->udp_len  = htons(8 + len);
 	ip->udp_xsum = 0;
-	ip->ip_sum   = ~NetCksum((uchar *)ip, IP_HDR_SIZE_NO_UDP / 2);
 }
 
 void copy_filename (char *dst, char *src, int size)
@@ -1892,7 +2018,8 @@ void copy_filename (char *dst, char *src, int size)
 	*dst = '\0';
 }
 
-#if defined(CONFIG_CMD_NFS) || defined(CONFIG_CMD_SNTP) || defined(CONFIG_CMD_DNS)
+#if defined(CONFIG_CMD_NFS) || defined(CONFIG_CMD_SNTP) || \
+    defined(CONFIG_CMD_DNS) || defined(CONFIG_CMD_WGET)
 /*
  * make port a little random, but use something trivial to compute
  */
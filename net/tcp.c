@@ -0,0 +1,590 @@
+/*
+ * Minimal TCP client
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <net.h>
+#include "tcp.h"
+
+#if CONFIG_TCP_WINDOW > 0xffff
+#error "CONFIG_TCP_WINDOW does not fit the window field (no window scaling)"
+#endif
+
+#define TCP_RTO_INIT	1000UL		/* millisecs before resending	*/
+#define TCP_RTO_MAX	8000UL		/* ... doubled up to this	*/
+#define TCP_RETRIES	6		/* resends before giving up	*/
+#define TCP_DELACK	20UL		/* millisecs an ACK may wait	*/
+#define TCP_IDLE	10000UL		/* millisecs of silence allowed	*/
+#define TCP_DEFAULT_MSS	536
+
+/* Sequence number comparisons, modulo 2^32 */
+#define SEQ_LT(a, b)	((int)((u32)(a) - (u32)(b)) < 0)
+#define SEQ_LE(a, b)	((int)((u32)(a) - (u32)(b)) <= 0)
+
+enum {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT_1,		/* we closed, FIN not acked yet		*/
+	TCP_FIN_WAIT_2,		/* we closed, waiting for the peer	*/
+	TCP_CLOSING,		/* both closed, our FIN not acked yet	*/
+	TCP_CLOSE_WAIT,		/* the peer closed, we have not		*/
+	TCP_LAST_ACK,		/* both closed, the peer first		*/
+};
+
+static int		TcpState;
+static IPaddr_t		TcpServerIP;
+static uchar		TcpServerEther[6];
+static int		TcpServerPort;
+static int		TcpOurPort;
+static tcp_recv_f	*TcpRecvHandler;
+static tcp_event_f	*TcpEventHandler;
+
+static u32		TcpIss;		/* our initial sequence number	*/
+static u32		TcpSndUna;	/* oldest unacknowledged	*/
+static u32		TcpSndNxt;	/* next to send			*/
+static int		TcpFinSent;	/* our FIN is at TcpSndNxt - 1	*/
+static unsigned		TcpPeerMss;
+static uchar		TcpTxData[TCP_MSS];	/* sent, not acked yet	*/
+static unsigned		TcpTxLen;
+
+static u32		TcpIrs;		/* the peer's initial sequence	*/
+static u32		TcpRcvNxt;	/* next expected		*/
+static u32		TcpOooSeq;	/* data held beyond a gap ...	*/
+static u32		TcpOooEnd;	/* ... up to here		*/
+static int		TcpOooFin;	/* ... and a FIN after it	*/
+static uchar		TcpOooBuf[CONFIG_TCP_WINDOW];	/* by seq % size */
+static int		TcpAckPending;	/* segments not acked yet	*/
+
+static ulong		TcpAckTime;	/* first unacked segment came	*/
+static ulong		TcpRtxTime;	/* last (re)transmission	*/
+static ulong		TcpRto;
+static int		TcpRetries;
+static ulong		TcpLastRx;
+
+static void TcpTimeout(void);
+
+/* Sequence numbers are only 2 byte aligned in the packet */
+static inline u32 TcpGetLong(ushort *p)
+{
+	return ((u32)ntohs(p[0]) << 16) | ntohs(p[1]);
+}
+
+static inline void TcpPutLong(ushort *p, u32 val)
+{
+	p[0] = htons(val >> 16);
+	p[1] = htons(val & 0xffff);
+}
+
+/* One's complement sum of the segment and its pseudo header */
+static unsigned
+TcpCksum(IPaddr_t src, IPaddr_t dst, uchar *seg, unsigned len)
+{
+	ulong xsum;
+	ushort last = 0;
+
+	xsum  = NetCksum((uchar *)&src, 2) + NetCksum((uchar *)&dst, 2);
+	xsum += htons(IPPROTO_TCP) + htons(len);
+	xsum += NetCksum(seg, len / 2);
+	if (len & 1) {
+		*(uchar *)&last = seg[len - 1];
+		xsum += last;
+	}
+	xsum = (xsum & 0xffff) + (xsum >> 16);
+	xsum = (xsum & 0xffff) + (xsum >> 16);
+	return xsum;
+}
+
+static void
+TcpSendSegment(u32 seq, int flags, const uchar *data, unsigned len)
+{
+	uchar *pkt = (uchar *)NetTxPacket + NetEthHdrSize() + IP_HDR_SIZE_NO_UDP;
+	TCP_t *th = (TCP_t *)pkt;
+	unsigned hlen = TCP_HDR_SIZE;
+
+	if (flags & TCP_SYN) {
+		/* MSS option */
+		pkt[hlen++] = 2;
+		pkt[hlen++] = 4;
+		pkt[hlen++] = TCP_MSS >> 8;
+		pkt[hlen++] = TCP_MSS & 0xff;
+	}
+
+	th->th_sport = htons(TcpOurPort);
+	th->th_dport = htons(TcpServerPort);
+	TcpPutLong(th->th_seq, seq);
+	TcpPutLong(th->th_ack, (flags & TCP_ACK) ? TcpRcvNxt : 0);
+	th->th_off = (hlen / 4) << 4;
+	th->th_flags = flags;
+	th->th_win = htons(CONFIG_TCP_WINDOW);
+	th->th_sum = 0;
+	th->th_urp = 0;
+	if (len)
+		memcpy(pkt + hlen, data, len);
+	th->th_sum = ~TcpCksum(NetOurIP, TcpServerIP, pkt, hlen + len);
+
+	if (flags & TCP_ACK)
+		TcpAckPending = 0;
+
+	NetSendIPPacket(TcpServerEther, TcpServerIP, IPPROTO_TCP, hlen + len);
+}
+
+static void TcpSendAck(void)
+{
+	TcpSendSegment(TcpSndNxt, TCP_ACK, NULL, 0);
+}
+
+/* Is anything of ours waiting to be acknowledged? */
+static int TcpOutstanding(void)
+{
+	return TcpState == TCP_SYN_SENT || TcpSndUna != TcpSndNxt;
+}
+
+/* Send everything not acknowledged yet again */
+static void TcpRetransmit(void)
+{
+	int flags = TCP_ACK;
+
+	TcpRtxTime = get_timer(0);
+
+	if (TcpState == TCP_SYN_SENT) {
+		TcpSendSegment(TcpIss, TCP_SYN, NULL, 0);
+		return;
+	}
+
+	if (TcpTxLen)
+		flags |= TCP_PSH;
+	if (TcpFinSent)
+		flags |= TCP_FIN;
+	TcpSendSegment(TcpSndUna, flags, TcpTxData, TcpTxLen);
+}
+
+/* Have TcpTimeout() called at the first thing that is due */
+static void TcpSetTimer(void)
+{
+	ulong now = get_timer(0);
+	long left, t;
+
+	if (TcpState == TCP_CLOSED)
+		return;
+
+	left = (long)(TcpLastRx + TCP_IDLE - now);
+	if (TcpOutstanding()) {
+		t = (long)(TcpRtxTime + TcpRto - now);
+		left = min(left, t);
+	}
+	if (TcpAckPending) {
+		t = (long)(TcpAckTime + TCP_DELACK - now);
+		left = min(left, t);
+	}
+
+	NetSetTimeout(left > 0 ? left : 1, TcpTimeout);
+}
+
+/* The connection is gone; tell the application last */
+static void TcpFinish(int event)
+{
+	TcpState = TCP_CLOSED;
+	(*TcpEventHandler)(event);
+}
+
+static void TcpTimeout(void)
+{
+	ulong now = get_timer(0);
+
+	if (TcpState == TCP_CLOSED)
+		return;
+
+	if (TcpAckPending && now - TcpAckTime >= TCP_DELACK)
+		TcpSendAck();
+
+	if (TcpOutstanding()) {
+		if (now - TcpRtxTime >= TcpRto) {
+			if (++TcpRetries > TCP_RETRIES) {
+				TcpFinish(TCP_EV_TIMEOUT);
+				return;
+			}
+			TcpRto = min(TcpRto * 2, TCP_RTO_MAX);
+			TcpRetransmit();
+		}
+	} else if (now - TcpLastRx >= TCP_IDLE) {
+		TcpFinish(TCP_EV_TIMEOUT);
+		return;
+	}
+
+	TcpSetTimer();
+}
+
+static unsigned TcpParseMss(TCP_t *th, unsigned hlen)
+{
+	uchar *opt = (uchar *)th + TCP_HDR_SIZE;
+	uchar *end = (uchar *)th + hlen;
+
+	while (opt < end && *opt != 0) {
+		if (*opt == 1) {		/* NOP */
+			opt++;
+			continue;
+		}
+		if (opt + 1 >= end || opt[1] < 2 || opt + opt[1] > end)
+			break;
+		if (opt[0] == 2 && opt[1] == 4)
+			return (opt[2] << 8) | opt[3];
+		opt += opt[1];
+	}
+
+	return TCP_DEFAULT_MSS;
+}
+
+/* The peer's FIN is next in sequence */
+static void TcpFin(void)
+{
+	TcpRcvNxt++;
+	TcpSendAck();
+
+	switch (TcpState) {
+	case TCP_ESTABLISHED:
+		TcpState = TCP_CLOSE_WAIT;
+		(*TcpEventHandler)(TCP_EV_EOF);
+		break;
+	case TCP_FIN_WAIT_1:
+		TcpState = TCP_CLOSING;
+		break;
+	case TCP_FIN_WAIT_2:
+		/* Nothing left to wait for; skip TIME_WAIT */
+		TcpFinish(TCP_EV_CLOSED);
+		break;
+	}
+}
+
+/*
+ * The window never holds more than CONFIG_TCP_WINDOW bytes, so data beyond
+ * a gap can be kept in a ring indexed by sequence number.
+ */
+static void TcpOooCopy(u32 seq, uchar *data, unsigned len)
+{
+	unsigned pos, n;
+
+	while (len) {
+		pos = (seq - TcpIrs) % CONFIG_TCP_WINDOW;
+		n = min(len, CONFIG_TCP_WINDOW - pos);
+		memcpy(TcpOooBuf + pos, data, n);
+		seq += n;
+		data += n;
+		len -= n;
+	}
+}
+
+/* Hand what we held on, now that it is in sequence */
+static int TcpOooPass(u32 seq, unsigned len)
+{
+	unsigned pos, n;
+
+	while (len) {
+		pos = (seq - TcpIrs) % CONFIG_TCP_WINDOW;
+		n = min(len, CONFIG_TCP_WINDOW - pos);
+		if ((*TcpRecvHandler)(seq - TcpIrs - 1, TcpOooBuf + pos, n) < 0)
+			return -1;
+		seq += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* Keep a segment that arrived beyond a gap, if it joins what we hold */
+static void TcpOooAdd(u32 seq, uchar *data, unsigned len, int fin)
+{
+	u32 end = seq + len;
+
+	if (TcpOooSeq != TcpOooEnd) {
+		if (SEQ_LT(TcpOooEnd, seq) || SEQ_LT(end, TcpOooSeq))
+			return;
+		if (TcpOooFin && SEQ_LT(TcpOooEnd, end))
+			return;
+		if (SEQ_LT(TcpOooEnd, end) || (fin && end == TcpOooEnd))
+			TcpOooFin = fin;
+	} else {
+		TcpOooSeq = seq;
+		TcpOooEnd = end;
+		TcpOooFin = fin;
+	}
+
+	TcpOooCopy(seq, data, len);
+	if (SEQ_LT(seq, TcpOooSeq))
+		TcpOooSeq = seq;
+	if (SEQ_LT(TcpOooEnd, end))
+		TcpOooEnd = end;
+}
+
+/* Pass the data and FIN of a segment on, and acknowledge them */
+static void TcpData(u32 seq, uchar *data, unsigned len, int fin)
+{
+	u32 wnd_end = TcpRcvNxt + CONFIG_TCP_WINDOW;
+	u32 off;
+
+	if (!len && !fin)
+		return;
+
+	if (TcpState != TCP_ESTABLISHED && TcpState != TCP_FIN_WAIT_1 &&
+	    TcpState != TCP_FIN_WAIT_2) {
+		/* Resent after their FIN: the ACK was lost */
+		TcpSendAck();
+		return;
+	}
+
+	/* Drop what we already have */
+	if (SEQ_LT(seq, TcpRcvNxt)) {
+		off = TcpRcvNxt - seq;
+		if (off > len || (off == len && !fin)) {
+			TcpSendAck();
+			return;
+		}
+		seq += off;
+		data += off;
+		len -= off;
+	}
+
+	/* ... and what does not fit in the window */
+	if (!SEQ_LT(seq, wnd_end) && len) {
+		TcpSendAck();
+		return;
+	}
+	if (SEQ_LT(wnd_end, seq + len)) {
+		len = wnd_end - seq;
+		fin = 0;
+	}
+
+	if (seq != TcpRcvNxt) {
+		/*
+		 * Beyond a gap: hold on to it, and send a duplicate ACK at
+		 * once so that the gap is resent quickly.
+		 */
+		TcpOooAdd(seq, data, len, fin);
+		TcpSendAck();
+		return;
+	}
+
+	if (TcpOooSeq != TcpOooEnd && SEQ_LT(TcpOooSeq, seq + len)) {
+		len = TcpOooSeq - seq;
+		fin = 0;
+	}
+
+	/*
+	 * Account for the data before handing it over, so that anything
+	 * the application sends in response acknowledges it.
+	 */
+	if (len) {
+		TcpRcvNxt += len;
+		if (!TcpAckPending++)
+			TcpAckTime = get_timer(0);
+		if ((*TcpRecvHandler)(seq - TcpIrs - 1, data, len) < 0)
+			goto abort;
+	}
+
+	/* The gap is filled */
+	if (TcpOooSeq != TcpOooEnd && TcpRcvNxt == TcpOooSeq) {
+		seq = TcpOooSeq;
+		len = TcpOooEnd - seq;
+		TcpRcvNxt = TcpOooSeq = TcpOooEnd;
+		fin = TcpOooFin;
+		TcpAckPending = 2;
+		if (TcpOooPass(seq, len) < 0)
+			goto abort;
+	}
+
+	if (fin)
+		TcpFin();
+	else if (TcpAckPending >= 2)
+		TcpSendAck();
+	return;
+
+abort:
+	TcpAbort();
+}
+
+void TcpReceive(IP_t *ip, unsigned len)
+{
+	TCP_t *th = (TCP_t *)((uchar *)ip + IP_HDR_SIZE_NO_UDP);
+	IPaddr_t src = NetReadIP(&ip->ip_src);
+	unsigned hlen, n;
+	u32 seq, ack;
+	int flags;
+
+	if (TcpState == TCP_CLOSED || len < IP_HDR_SIZE_NO_UDP + TCP_HDR_SIZE)
+		return;
+	len -= IP_HDR_SIZE_NO_UDP;
+
+	if (src != TcpServerIP || ntohs(th->th_sport) != TcpServerPort ||
+	    ntohs(th->th_dport) != TcpOurPort)
+		return;
+
+	hlen = (th->th_off >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || hlen > len)
+		return;
+	if (TcpCksum(src, NetReadIP(&ip->ip_dst), (uchar *)th, len) != 0xffff) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	seq = TcpGetLong(th->th_seq);
+	ack = TcpGetLong(th->th_ack);
+	flags = th->th_flags;
+	TcpLastRx = get_timer(0);
+
+	if (TcpState == TCP_SYN_SENT) {
+		if (!(flags & TCP_ACK) || ack != TcpIss + 1)
+			return;
+		if (flags & TCP_RST) {
+			TcpFinish(TCP_EV_RESET);
+			return;
+		}
+		if (!(flags & TCP_SYN))
+			return;
+
+		TcpIrs = seq;
+		TcpRcvNxt = TcpOooSeq = TcpOooEnd = seq + 1;
+		TcpSndUna = ack;
+		TcpPeerMss = TcpParseMss(th, hlen);
+		TcpState = TCP_ESTABLISHED;
+		TcpRetries = 0;
+		TcpRto = TCP_RTO_INIT;
+		TcpSendAck();
+		TcpSetTimer();
+		(*TcpEventHandler)(TCP_EV_CONNECTED);
+		return;
+	}
+
+	if (flags & TCP_RST) {
+		if (!SEQ_LT(seq, TcpRcvNxt) &&
+		    SEQ_LT(seq, TcpRcvNxt + CONFIG_TCP_WINDOW))
+			TcpFinish(TCP_EV_RESET);
+		return;
+	}
+	if (flags & TCP_SYN) {
+		/* The SYN+ACK again: our ACK of it was lost */
+		TcpSendAck();
+		return;
+	}
+	if (!(flags & TCP_ACK))
+		return;
+
+	/* Our data or FIN acknowledged */
+	if (SEQ_LT(TcpSndUna, ack) && SEQ_LE(ack, TcpSndNxt)) {
+		n = min(ack - TcpSndUna, TcpTxLen);
+		memmove(TcpTxData, TcpTxData + n, TcpTxLen - n);
+		TcpTxLen -= n;
+		TcpSndUna = ack;
+		TcpRetries = 0;
+		TcpRto = TCP_RTO_INIT;
+		TcpRtxTime = TcpLastRx;
+
+		if (TcpFinSent && ack == TcpSndNxt) {
+			switch (TcpState) {
+			case TCP_FIN_WAIT_1:
+				TcpState = TCP_FIN_WAIT_2;
+				break;
+			case TCP_CLOSING:
+			case TCP_LAST_ACK:
+				TcpFinish(TCP_EV_CLOSED);
+				return;
+			}
+		}
+	}
+
+	TcpData(seq, (uchar *)th + hlen, len - hlen, flags & TCP_FIN);
+	TcpSetTimer();
+}
+
+/*
+ * Open a connection to dest:dport.  recv() gets the data and event() is
+ * told when the connection is up and when it ends.
+ */
+void
+TcpConnect(IPaddr_t dest, int dport, tcp_recv_f *recv, tcp_event_f *event)
+{
+	TcpServerIP = dest;
+	TcpServerPort = dport;
+	memset(TcpServerEther, 0, sizeof(TcpServerEther));
+	TcpRecvHandler = recv;
+	TcpEventHandler = event;
+
+	TcpOurPort = random_port();
+	TcpIss = (get_timer(0) << 10) ^ (TcpOurPort << 16);
+	TcpSndUna = TcpIss;
+	TcpSndNxt = TcpIss + 1;
+	TcpFinSent = 0;
+	TcpTxLen = 0;
+	TcpPeerMss = TCP_DEFAULT_MSS;
+	TcpAckPending = 0;
+
+	TcpState = TCP_SYN_SENT;
+	TcpRto = TCP_RTO_INIT;
+	TcpRetries = 0;
+	TcpLastRx = get_timer(0);
+	TcpRetransmit();
+	TcpSetTimer();
+}
+
+/* Send len bytes, which must fit in one segment */
+int TcpSend(const uchar *data, unsigned len)
+{
+	if ((TcpState != TCP_ESTABLISHED && TcpState != TCP_CLOSE_WAIT) ||
+	    TcpTxLen || TcpFinSent || len > min(TcpPeerMss, (unsigned)TCP_MSS))
+		return -1;
+
+	memcpy(TcpTxData, data, len);
+	TcpTxLen = len;
+	TcpSndNxt += len;
+	TcpRetries = 0;
+	TcpRetransmit();
+	TcpSetTimer();
+
+	return 0;
+}
+
+void TcpClose(void)
+{
+	switch (TcpState) {
+	case TCP_ESTABLISHED:
+		TcpState = TCP_FIN_WAIT_1;
+		break;
+	case TCP_CLOSE_WAIT:
+		TcpState = TCP_LAST_ACK;
+		break;
+	default:
+		return;
+	}
+
+	TcpFinSent = 1;
+	TcpSndNxt++;
+	TcpRetries = 0;
+	TcpRetransmit();
+	TcpSetTimer();
+}
+
+void TcpAbort(void)
+{
+	if (TcpState == TCP_CLOSED)
+		return;
+
+	TcpSendSegment(TcpSndNxt, TCP_RST | TCP_ACK, NULL, 0);
+	TcpState = TCP_CLOSED;
+}
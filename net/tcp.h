@@ -0,0 +1,72 @@
+/*
+ * Minimal TCP client
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+/*
+ * One connection at a time, opened by us and built for pulling a large
+ * download: in-order data goes straight from the received packet to the
+ * application, the receive window slides as soon as it has been handed
+ * over, and every second full segment is acknowledged.  Data that arrives
+ * beyond a gap is held until the gap is filled.  Data we send must fit
+ * into one segment.
+ */
+
+#define TCP_MSS		1460		/* largest segment we accept	*/
+
+#ifndef CONFIG_TCP_WINDOW
+#define CONFIG_TCP_WINDOW	(8 * TCP_MSS)	/* receive window, bytes */
+#endif
+
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PSH		0x08
+#define TCP_ACK		0x10
+
+typedef struct {
+	ushort		th_sport;	/* source port			*/
+	ushort		th_dport;	/* destination port		*/
+	ushort		th_seq[2];	/* sequence number		*/
+	ushort		th_ack[2];	/* acknowledgement number	*/
+	uchar		th_off;		/* header length / 4, << 4	*/
+	uchar		th_flags;	/* TCP_*			*/
+	ushort		th_win;		/* window			*/
+	ushort		th_sum;		/* checksum			*/
+	ushort		th_urp;		/* urgent pointer		*/
+} TCP_t;
+
+#define TCP_HDR_SIZE	(sizeof (TCP_t))
+
+/* Events passed to the application's tcp_event_f */
+#define TCP_EV_CONNECTED	1	/* TcpSend() may be called	*/
+#define TCP_EV_EOF		2	/* the peer will send no more	*/
+#define TCP_EV_CLOSED		3	/* both sides have closed	*/
+#define TCP_EV_RESET		4	/* reset by the peer		*/
+#define TCP_EV_TIMEOUT		5	/* peer gone silent		*/
+
+/*
+ * Called with received data at stream offset "offset", always in order.
+ * Return 0, or -1 to reset the connection.
+ */
+typedef int	tcp_recv_f(ulong offset, uchar *data, unsigned len);
+typedef void	tcp_event_f(int event);
+
+extern void	TcpConnect(IPaddr_t dest, int dport, tcp_recv_f *recv,
+			   tcp_event_f *event);
+extern int	TcpSend(const uchar *data, unsigned len);
+extern void	TcpClose(void);		/* send FIN after our data	*/
+extern void	TcpAbort(void);		/* send RST			*/
+extern void	TcpReceive(IP_t *ip, unsigned len); /* from NetReceive() */
+
+#endif /* __TCP_H__ */
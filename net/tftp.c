@@ -7,11 +7,16 @@
 #include <common.h>
 #include <command.h>
 #include <net.h>
+#include <div64.h>
+#ifdef CONFIG_SPI_FLASH_STREAM
+#include <spi_flash.h>
+#endif
 #include "tftp.h"
 #include "bootp.h"
 
 #define WELL_KNOWN_PORT	69		/* Well known TFTP port #		*/
 #define TIMEOUT		5000UL		/* Millisecs to timeout for lost pkt */
+#define RTO_MIN		20UL		/* Millisecs floor of adaptive timeout */
 #ifndef	CONFIG_NET_RETRY_COUNT
 # define TIMEOUT_COUNT	10		/* # of timeouts before giving up  */
 #else
@@ -33,6 +38,24 @@
 static ulong TftpTimeoutMSecs = TIMEOUT;
 static int TftpTimeoutCountMax = TIMEOUT_COUNT;
 
+/*
+ * Retransmission timer (Jacobson/Karels, RFC 6298).  TftpTimeoutMSecs is
+ * the starting value and the ceiling; once the RRQ has been answered the
+ * timeout follows the measured round trip, so a lost block on a LAN costs
+ * milliseconds rather than seconds.  Only the answer to a packet that was
+ * sent once is timed (Karn), and each timeout doubles the value up to the
+ * ceiling.  Timeouts only count against TftpTimeoutCountMax there.
+ */
+static ulong	TftpRto;		/* current timeout, ms			*/
+static ulong	TftpSrtt;		/* smoothed round trip, 1/8 ms		*/
+static ulong	TftpRttVar;		/* round trip variation, 1/4 ms		*/
+static ulong	TftpSendTime;		/* when the timed packet was sent	*/
+static int	TftpTiming;		/* TftpSendTime is valid		*/
+static ulong	TftpRttSum;		/* statistics for this transfer		*/
+static ulong	TftpRttSamples;
+static ulong	TftpRetransmits;
+static ulong	TftpStartTime;
+
 /*
  * These globals govern the timeout behavior when attempting a connection to a
  * TFTP server. TftpRRQTimeoutMSecs specifies the number of milliseconds to
@@ -95,6 +118,9 @@ static char tftp_filename[MAX_LEN];
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 extern flash_info_t flash_info[];
 #endif
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP_ERASE
+static ulong	TftpFlashErased;	/* flash erased up to here so far	*/
+#endif
 
 /* 512 is poor choice for ethernet, MTU is typically 1500.
  * Minus eth.hdrs thats 1468.  Can get 2x better throughput with
@@ -114,6 +140,24 @@ extern flash_info_t flash_info[];
 static unsigned short TftpBlkSize=TFTP_BLOCK_SIZE;
 static unsigned short TftpBlkSizeOption=TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: the server sends this many blocks before waiting
+ * for an ACK, so a transfer is no longer bound by one round trip per
+ * block.  1 is plain lock-step TFTP and the option is not requested.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+/* Larger windows make blocks past a gap look like old duplicates */
+#define TFTP_WINDOWSIZE_MAX	((long)TFTP_SEQUENCE_SIZE / 2 - 1)
+
+static unsigned short TftpWindowSize=1;	/* negotiated window		*/
+static unsigned short TftpWindowSizeOption=TFTP_WINDOWSIZE;
+static unsigned short TftpWindowPos;	/* blocks since our last ACK	*/
+static int	TftpGapAcked;		/* re-ACKed the current gap already */
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -139,6 +183,47 @@ mcast_cleanup(void)
 
 #endif	/* CONFIG_MCAST_TFTP */
 
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP_ERASE
+/*
+ * Erase the sectors of info that [addr, addr + len) reaches and this
+ * transfer has not erased yet.  The data arrives in order, so this keeps
+ * the erase just ahead of the writes instead of needing an "erase" of the
+ * whole area first.
+ */
+static int
+tftp_flash_erase (flash_info_t *info, ulong addr, ulong len)
+{
+	ulong start, next = 0;
+	int s, first = -1, last = -1;
+
+	for (s = 0; s < info->sector_count; s++) {
+		start = info->start[s];
+		next = (s + 1 < info->sector_count) ? info->start[s + 1] :
+				info->start[0] + info->size;
+		if (next <= addr || start >= addr + len ||
+		    next <= TftpFlashErased)
+			continue;
+		if (start < load_addr) {
+			printf ("\nLoad address 0x%lx is not at the start of "
+				"a flash sector\n", load_addr);
+			return -1;
+		}
+		if (first < 0)
+			first = s;
+		last = s;
+	}
+
+	if (first < 0)
+		return 0;
+	if (flash_erase (info, first, last))
+		return -1;
+
+	TftpFlashErased = (last + 1 < info->sector_count) ?
+			info->start[last + 1] : info->start[0] + info->size;
+	return 0;
+}
+#endif /* CONFIG_SYS_DIRECT_FLASH_TFTP_ERASE */
+
 static __inline__ void
 store_block (unsigned block, uchar * src, unsigned len)
 {
@@ -156,8 +241,27 @@ store_block (unsigned block, uchar * src, unsigned len)
 			break;
 		}
 	}
+#endif /* CONFIG_SYS_DIRECT_FLASH_TFTP */
 
+#ifdef CONFIG_SPI_FLASH_STREAM
+	if (NetFlashStream) {
+		/* Buffered, and programmed while the next blocks arrive */
+		if (spi_flash_stream_write (NetFlashStream, offset,
+					    src, len)) {
+			NetState = NETLOOP_FAIL;
+			return;
+		}
+	}
+	else
+#endif
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	if (rc) { /* Flash is destination for this packet */
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP_ERASE
+		if (tftp_flash_erase (&flash_info[i], load_addr + offset, len)) {
+			NetState = NETLOOP_FAIL;
+			return;
+		}
+#endif
 		rc = flash_write ((char *)src, (ulong)(load_addr+offset), len);
 		if (rc) {
 			flash_perror (rc);
@@ -182,6 +286,52 @@ store_block (unsigned block, uchar * src, unsigned len)
 static void TftpSend (void);
 static void TftpTimeout (void);
 
+/* Take a round trip sample from a reply to the last packet we sent */
+static void TftpRttSample (void)
+{
+	long rtt, delta;
+
+	if (!TftpTiming)
+		return;
+	TftpTiming = 0;
+
+	rtt = get_timer (TftpSendTime);
+	TftpRttSum += rtt;
+	TftpRttSamples++;
+
+	if (TftpRttSamples == 1) {
+		TftpSrtt = rtt << 3;
+		TftpRttVar = rtt << 1;
+	} else {
+		delta = rtt - (TftpSrtt >> 3);
+		TftpSrtt += delta;
+		if (delta < 0)
+			delta = -delta;
+		TftpRttVar += delta - (TftpRttVar >> 2);
+	}
+
+	TftpRto = (TftpSrtt >> 3) + TftpRttVar;
+	if (TftpRto < RTO_MIN)
+		TftpRto = RTO_MIN;
+	if (TftpRto > TftpTimeoutMSecs)
+		TftpRto = TftpTimeoutMSecs;
+}
+
+static void TftpPrintStats (void)
+{
+	ulong ms = get_timer (TftpStartTime);
+	ulong avg = 0;
+
+	if (TftpRttSamples)
+		avg = TftpRttSum * 10 / TftpRttSamples;
+	if (ms == 0)
+		ms = 1;
+
+	printf ("%lu retransmits, average RTT %lu.%lu ms, %lu KiB/s\n",
+		TftpRetransmits, avg / 10, avg % 10,
+		(ulong)lldiv ((u64)NetBootFileXferSize * 1000, ms * 1024));
+}
+
 /**********************************************************************/
 
 static void
@@ -228,6 +378,9 @@ TftpSend (void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt,"blksize%c%d%c",
 				0,TftpBlkSizeOption,0);
+		if (TftpWindowSizeOption > 1)
+			pkt += sprintf((char *)pkt,"windowsize%c%d%c",
+					0,TftpWindowSizeOption,0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!ProhibitMcast
@@ -281,6 +434,10 @@ TftpSend (void)
 	}
 
 	NetSendUDPPacket(NetServerEther, TftpServerIP, TftpServerPort, TftpOurPort, len);
+
+	/* The reply to this packet gives the next round trip sample */
+	TftpSendTime = get_timer (0);
+	TftpTiming = 1;
 }
 
 
@@ -325,6 +482,8 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 			pkt + strlen((char *)pkt) + 1);
 		TftpState = STATE_OACK;
 		TftpServerPort = src;
+		TftpRttSample ();
+		NetSetTimeout (TftpRto, TftpTimeout);
 		/*
 		 * Check for 'blksize' option.
 		 * Careful: "i" is signed, "len" is unsigned, thus
@@ -337,6 +496,15 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 				debug("Blocksize ack: %s, %d\n",
 					(char*)pkt+i+8,TftpBlkSize);
 			}
+			if (strcmp ((char*)pkt+i,"windowsize") == 0) {
+				ulong win = simple_strtoul((char*)pkt+i+11,
+							   NULL,10);
+				/* The server may only shrink the window */
+				if (win >= 1 && win <= TftpWindowSizeOption)
+					TftpWindowSize = win;
+				debug("Windowsize ack: %s, %d\n",
+					(char*)pkt+i+11,TftpWindowSize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp ((char*)pkt+i,"tsize") == 0) {
 				TftpTsize = simple_strtoul((char*)pkt+i+6,NULL,10);
@@ -345,8 +513,12 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 			}
 #endif
 		}
+		TftpWindowPos = 0;
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt,len-1);
+		/* Multicast clients track blocks in the bitmap instead */
+		if (Multicast)
+			TftpWindowSize = 1;
 		if ((Multicast) && (!MasterClient))
 			TftpState = STATE_DATA;	/* passive.. */
 		else
@@ -359,6 +531,68 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 		len -= 2;
 		TftpBlock = ntohs(*(ushort *)pkt);
 
+		if (TftpState == STATE_RRQ)
+			debug("Server did not acknowledge timeout option!\n");
+
+		if (TftpState == STATE_RRQ || TftpState == STATE_OACK) {
+			/* first block received */
+			TftpState = STATE_DATA;
+			TftpServerPort = src;
+			TftpLastBlock = 0;
+			TftpBlockWrap = 0;
+			TftpBlockWrapOffset = 0;
+			TftpWindowPos = 0;
+			TftpGapAcked = 0;
+
+#ifdef CONFIG_MCAST_TFTP
+			if (Multicast) { /* start!=1 common if mcast */
+				TftpLastBlock = TftpBlock - 1;
+			} else
+#endif
+			if (TftpBlock != 1) {	/* Assertion */
+				printf ("\nTFTP error: "
+					"First block is not block 1 (%ld)\n"
+					"Starting again\n\n",
+					TftpBlock);
+				NetStartAgain ();
+				break;
+			}
+		}
+
+		if (TftpBlock == TftpLastBlock) {
+			/*
+			 *	Same block again; ignore it.
+			 */
+			break;
+		}
+
+		if (TftpWindowSize > 1 &&
+		    TftpBlock != ((TftpLastBlock + 1) % TFTP_SEQUENCE_SIZE)) {
+			ulong ahead = (TftpBlock - TftpLastBlock - 1) %
+					TFTP_SEQUENCE_SIZE;
+
+			/*
+			 *	A block of the window went missing.  Drop the
+			 *	rest and ACK the last one received in order so
+			 *	that the server restarts the window after it.
+			 *	Only once per gap, or every block still in
+			 *	flight would restart the window again.  Blocks
+			 *	from behind us are retransmissions we already
+			 *	have and are dropped silently.
+			 */
+			debug("Expected block %lu, got %lu\n",
+				(TftpLastBlock + 1) % TFTP_SEQUENCE_SIZE,
+				TftpBlock);
+			TftpBlock = TftpLastBlock;
+			if (ahead < TFTP_SEQUENCE_SIZE / 2 && !TftpGapAcked) {
+				TftpGapAcked = 1;
+				TftpWindowPos = 0;
+				TftpSend ();
+			}
+			break;
+		}
+		TftpGapAcked = 0;
+
 		/*
 		 * RFC1350 specifies that the first data packet will
 		 * have sequence number 1. If we receive a sequence
@@ -394,49 +628,33 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 		}
 #endif
 
-		if (TftpState == STATE_RRQ)
-			debug("Server did not acknowledge timeout option!\n");
-
-		if (TftpState == STATE_RRQ || TftpState == STATE_OACK) {
-			/* first block received */
-			TftpState = STATE_DATA;
-			TftpServerPort = src;
-			TftpLastBlock = 0;
-			TftpBlockWrap = 0;
-			TftpBlockWrapOffset = 0;
-
-#ifdef CONFIG_MCAST_TFTP
-			if (Multicast) { /* start!=1 common if mcast */
-				TftpLastBlock = TftpBlock - 1;
-			} else
-#endif
-			if (TftpBlock != 1) {	/* Assertion */
-				printf ("\nTFTP error: "
-					"First block is not block 1 (%ld)\n"
-					"Starting again\n\n",
-					TftpBlock);
-				NetStartAgain ();
-				break;
-			}
-		}
-
-		if (TftpBlock == TftpLastBlock) {
-			/*
-			 *	Same block again; ignore it.
-			 */
-			break;
-		}
-
+		/* In-order block: the reply to our last ACK, or to the RRQ */
+		TftpRttSample ();
 		TftpLastBlock = TftpBlock;
+		TftpTimeoutCount = 0;
 		TftpTimeoutCountMax = TIMEOUT_COUNT;
-		NetSetTimeout (TftpTimeoutMSecs, TftpTimeout);
 
 		store_block (TftpBlock - 1, pkt + 2, len);
+		if (NetState == NETLOOP_FAIL)
+			break;
+
+		/*
+		 * Arm the timeout only now: a slow store (a flash write, or
+		 * a full flash stream ring) must not count against the peer.
+		 */
+		NetSetTimeout (TftpRto, TftpTimeout);
 
 		/*
 		 *	Acknoledge the block just received, which will prompt
-		 *	the server for the next one.
+		 *	the server for the next one.  With a window only the
+		 *	last block of each window and the final block are
+		 *	acknowledged.
 		 */
+		if (TftpWindowSize > 1 && len == TftpBlkSize &&
+		    ++TftpWindowPos < TftpWindowSize)
+			break;
+		TftpWindowPos = 0;
+
 #ifdef CONFIG_MCAST_TFTP
 		/* if I am the MasterClient, actively calculate what my next
 		 * needed block is; else I'm passive; not ACKING
@@ -461,6 +679,20 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 				TftpLastBlock = TftpBlock;
 			}
 		}
+#endif
+#ifdef CONFIG_SPI_FLASH_STREAM
+		/*
+		 * Make room for the whole next window before asking for it,
+		 * so the flash never holds us up while blocks are arriving.
+		 */
+		if (NetFlashStream && len == TftpBlkSize) {
+			if (spi_flash_stream_reserve (NetFlashStream,
+					TftpWindowSize * TftpBlkSize)) {
+				NetState = NETLOOP_FAIL;
+				break;
+			}
+			NetSetTimeout (TftpRto, TftpTimeout);
+		}
 #endif
 		TftpSend ();
 
@@ -468,6 +700,7 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 		if (Multicast) {
 			if (MasterClient && (TftpBlock >= TftpEndingBlock)) {
 				puts ("\nMulticast tftp done\n");
+				TftpPrintStats ();
 				mcast_cleanup();
 				NetState = NETLOOP_SUCCESS;
 			}
@@ -485,8 +718,18 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 				putc('#');
 				TftpNumchars++;
 			}
+#endif
+#ifdef CONFIG_SPI_FLASH_STREAM
+			if (NetFlashStream) {
+				putc ('\n');
+				if (spi_flash_stream_finish (NetFlashStream)) {
+					NetState = NETLOOP_FAIL;
+					break;
+				}
+			}
 #endif
 			puts ("\ndone\n");
+			TftpPrintStats ();
 			NetState = NETLOOP_SUCCESS;
 		}
 		break;
@@ -527,7 +770,8 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 static void
 TftpTimeout (void)
 {
-	if (++TftpTimeoutCount > TftpTimeoutCountMax) {
+	if (TftpRto >= TftpTimeoutMSecs &&
+	    ++TftpTimeoutCount > TftpTimeoutCountMax) {
 		puts ("\nRetry count exceeded; starting again\n");
 #ifdef GARCIA_FPGA_STATUS_LED_A
 		if(++TftpRetryCount > RETRY_COUNT) {
@@ -550,8 +794,15 @@ TftpTimeout (void)
 		          GARCIA_FPGA_STATUS_LED_FLASH | GARCIA_FPGA_POWER_LED_B);
 		}
 #endif
-		NetSetTimeout (TftpTimeoutMSecs, TftpTimeout);
+		TftpRetransmits++;
+		/* Back off, the reply may just be late */
+		TftpRto = min (TftpRto * 2, TftpTimeoutMSecs);
+		NetSetTimeout (TftpRto, TftpTimeout);
+		/* The server starts a new window after the block we ACK */
+		TftpWindowPos = 0;
 		TftpSend ();
+		/* A reply could be to either copy, so do not time it */
+		TftpTiming = 0;
 	}
 }
 
@@ -560,6 +811,7 @@ void
 TftpStart (void)
 {
 	char *ep;             /* Environment pointer */
+	long win;
 
 	/*
 	 * Allow the user to choose TFTP blocksize and timeout.
@@ -571,6 +823,16 @@ TftpStart (void)
 	if ((ep = getenv("tftptimeout")) != NULL)
 		TftpTimeoutMSecs = simple_strtol(ep, NULL, 10);
 
+	/* Unsetting tftpwindowsize goes back to the default */
+	win = TFTP_WINDOWSIZE;
+	if ((ep = getenv("tftpwindowsize")) != NULL)
+		win = simple_strtol(ep, NULL, 10);
+	if (win < 1 || win > TFTP_WINDOWSIZE_MAX) {
+		win = win < 1 ? 1 : TFTP_WINDOWSIZE_MAX;
+		printf("TFTP windowsize out of range, set %ld\n", win);
+	}
+	TftpWindowSizeOption = win;
+
 	if (TftpTimeoutMSecs < 1000) {
 		printf("TFTP timeout (%ld ms) too low, "
 			"set minimum = 1000 ms\n",
@@ -578,8 +840,8 @@ TftpStart (void)
 		TftpTimeoutMSecs = 1000;
 	}
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-		TftpBlkSizeOption, TftpTimeoutMSecs);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+		TftpBlkSizeOption, TftpWindowSizeOption, TftpTimeoutMSecs);
 
 	TftpServerIP = NetServerIP;
 	if (BootFile[0] == '\0') {
@@ -632,13 +894,26 @@ TftpStart (void)
 
 	putc ('\n');
 
+#ifdef CONFIG_SPI_FLASH_STREAM
+	if (NetFlashStream)
+		printf ("Flash offset: 0x%x\n", NetFlashStream->base);
+	else
+#endif
 	printf ("Load address: 0x%lx\n", load_addr);
 
 	puts ("Loading: *\b");
 
 	TftpTimeoutCountMax = TftpRRQTimeoutCountMax;
 
-	NetSetTimeout (TftpTimeoutMSecs, TftpTimeout);
+	/* Until the RRQ is answered there is nothing to adapt to */
+	TftpRto = TftpTimeoutMSecs;
+	TftpTiming = 0;
+	TftpRttSum = 0;
+	TftpRttSamples = 0;
+	TftpRetransmits = 0;
+	TftpStartTime = get_timer (0);
+
+	NetSetTimeout (TftpRto, TftpTimeout);
 	NetSetHandler (TftpHandler);
 
 	TftpServerPort = WELL_KNOWN_PORT;
@@ -661,6 +936,16 @@ TftpStart (void)
 	memset(NetServerEther, 0, 6);
 	/* Revert TftpBlkSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	/* Lock-step unless the server acknowledges a window */
+	TftpWindowSize = 1;
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP_ERASE
+	TftpFlashErased = 0;
+#endif
+#ifdef CONFIG_SPI_FLASH_STREAM
+	/* A restarted transfer writes the flash from the start again */
+	if (NetFlashStream)
+		spi_flash_stream_rewind (NetFlashStream);
+#endif
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -0,0 +1,425 @@
+/*
+ * HTTP download over TCP
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <command.h>
+#include <net.h>
+#include <div64.h>
+#ifdef CONFIG_SPI_FLASH_STREAM
+#include <spi_flash.h>
+#endif
+#include "tcp.h"
+#include "wget.h"
+
+#define HASHES_PER_LINE	65		/* Number of "loading" hashes per line	*/
+#define WGET_HASH_BYTES	(64 << 10)	/* Bytes per hash			*/
+#define WGET_LINE_SIZE	256		/* Longer header lines are cut short	*/
+
+enum {
+	WGET_STATUS,		/* waiting for the status line		*/
+	WGET_HEADER,		/* header lines				*/
+	WGET_BODY,		/* body with a length or up to the FIN	*/
+	WGET_CHUNK_SIZE,	/* chunked body: size line		*/
+	WGET_CHUNK_DATA,
+	WGET_CHUNK_END,		/* CRLF after the chunk data		*/
+	WGET_TRAILER,		/* trailer lines after the last chunk	*/
+	WGET_DONE,		/* whole body received			*/
+};
+
+static IPaddr_t	WgetServerIP;
+static int	WgetServerPort;
+static char	WgetHost[64];		/* for the Host: header		*/
+static char	WgetPath[128];
+static char	WgetRequest[TCP_MSS];
+static int	WgetRequestLen;
+
+static int	WgetState;
+static char	WgetLine[WGET_LINE_SIZE];
+static int	WgetLineLen;
+static ulong	WgetBodyLen;		/* body bytes stored so far	*/
+static ulong	WgetContentLength;
+static int	WgetHaveLength;
+static int	WgetChunked;
+static ulong	WgetChunkLeft;
+static ulong	WgetNextHash;
+static int	WgetHashes;
+static ulong	WgetStartTime;
+
+/* Split "[http://][host[:port]]/path" out of BootFile */
+static int WgetParseURL(void)
+{
+	char *url = BootFile;
+	char *path, *port;
+	int n;
+
+	if (strncmp(url, "http://", 7) == 0)
+		url += 7;
+
+	path = strchr(url, '/');
+	if (!path)
+		path = url + strlen(url);
+	n = path - url;
+
+	WgetServerIP = NetServerIP;
+	WgetServerPort = WGET_DEFAULT_PORT;
+	if (n) {
+		if (n >= sizeof(WgetHost)) {
+			puts("*** ERROR: host name too long\n");
+			return -1;
+		}
+		memcpy(WgetHost, url, n);
+		WgetHost[n] = '\0';
+
+		port = strchr(WgetHost, ':');
+		if (port) {
+			*port = '\0';
+			WgetServerIP = string_to_ip(WgetHost);
+			WgetServerPort = simple_strtoul(port + 1, NULL, 10);
+			*port = ':';
+		} else {
+			WgetServerIP = string_to_ip(WgetHost);
+		}
+	} else {
+		ip_to_string(NetServerIP, WgetHost);
+	}
+
+	if (WgetServerIP == 0 || WgetServerPort == 0) {
+		puts("*** ERROR: no HTTP server; give one in the URL "
+			"or set `serverip'\n");
+		return -1;
+	}
+
+	strncpy(WgetPath, *path ? path : "/", sizeof(WgetPath));
+	WgetPath[sizeof(WgetPath) - 1] = '\0';
+
+	return 0;
+}
+
+static void WgetProgress(void)
+{
+	while (WgetBodyLen >= WgetNextHash) {
+		putc('#');
+		if (++WgetHashes % HASHES_PER_LINE == 0)
+			puts("\n\t ");
+		WgetNextHash += WGET_HASH_BYTES;
+	}
+}
+
+/* Put body bytes at offset off of the file */
+static int WgetStore(ulong off, uchar *data, unsigned len)
+{
+#ifdef CONFIG_SPI_FLASH_STREAM
+	if (NetFlashStream) {
+		/*
+		 * Leave room for a whole window, so that the flash only
+		 * holds up the sender and never drops what is in flight.
+		 */
+		if (spi_flash_stream_write(NetFlashStream, off, data, len) ||
+		    spi_flash_stream_reserve(NetFlashStream,
+					     CONFIG_TCP_WINDOW))
+			return -1;
+		return 0;
+	}
+#endif
+	memcpy((void *)(load_addr + off), data, len);
+	return 0;
+}
+
+/* The body is complete: close our side, the server is closing too */
+static void WgetComplete(void)
+{
+	WgetState = WGET_DONE;
+	TcpClose();
+}
+
+static void WgetPrintStats(void)
+{
+	ulong ms = get_timer(WgetStartTime);
+
+	if (ms == 0)
+		ms = 1;
+	printf("%lu KiB/s\n",
+		(ulong)lldiv((u64)WgetBodyLen * 1000, ms * 1024));
+}
+
+static void WgetDone(void)
+{
+#ifdef CONFIG_SPI_FLASH_STREAM
+	if (NetFlashStream) {
+		putc('\n');
+		if (spi_flash_stream_finish(NetFlashStream)) {
+			NetState = NETLOOP_FAIL;
+			return;
+		}
+	}
+#endif
+	puts("\ndone\n");
+	NetBootFileXferSize = WgetBodyLen;
+	WgetPrintStats();
+	NetState = NETLOOP_SUCCESS;
+}
+
+/* Act on one complete line of the response head or chunk framing */
+static int WgetHandleLine(char *line)
+{
+	char *end;
+	ulong size;
+
+	switch (WgetState) {
+	case WGET_STATUS:
+		if (strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) {
+			puts("\nBad HTTP response\n");
+			return -1;
+		}
+		if (simple_strtoul(line + 9, NULL, 10) != 200) {
+			printf("\nHTTP error %s\n", line + 9);
+			return -1;
+		}
+		WgetState = WGET_HEADER;
+		break;
+
+	case WGET_HEADER:
+		if (*line == '\0') {
+			if (WgetChunked) {
+				WgetState = WGET_CHUNK_SIZE;
+			} else {
+				WgetState = WGET_BODY;
+				if (WgetHaveLength && WgetContentLength == 0)
+					WgetComplete();
+			}
+			break;
+		}
+		if (strnicmp(line, "Content-Length:", 15) == 0) {
+			/* simple_strtoul() does not skip white space */
+			for (line += 15; *line == ' ' || *line == '\t'; line++)
+				;
+			WgetContentLength = simple_strtoul(line, NULL, 10);
+			WgetHaveLength = 1;
+		} else if (strnicmp(line, "Transfer-Encoding:", 18) == 0 &&
+			   strstr(line + 18, "chunked")) {
+			WgetChunked = 1;
+		}
+		break;
+
+	case WGET_CHUNK_SIZE:
+		size = simple_strtoul(line, &end, 16);
+		if (end == line) {
+			puts("\nBad chunk size\n");
+			return -1;
+		}
+		if (size) {
+			WgetChunkLeft = size;
+			WgetState = WGET_CHUNK_DATA;
+		} else {
+			WgetState = WGET_TRAILER;
+		}
+		break;
+
+	case WGET_CHUNK_END:
+		if (*line != '\0') {
+			puts("\nBad chunk end\n");
+			return -1;
+		}
+		WgetState = WGET_CHUNK_SIZE;
+		break;
+
+	case WGET_TRAILER:
+		if (*line == '\0')
+			WgetComplete();
+		break;
+	}
+
+	return 0;
+}
+
+/* Collect a line; returns the bytes used, or -1 on a bad line */
+static int WgetLineInput(uchar *data, unsigned len)
+{
+	uchar *nl = memchr(data, '\n', len);
+	unsigned n = nl ? nl - data + 1 : len;
+	unsigned room = WGET_LINE_SIZE - 1 - WgetLineLen;
+
+	memcpy(WgetLine + WgetLineLen, data, min(n, room));
+	WgetLineLen += min(n, room);
+	if (!nl)
+		return n;
+
+	while (WgetLineLen && (WgetLine[WgetLineLen - 1] == '\n' ||
+			       WgetLine[WgetLineLen - 1] == '\r'))
+		WgetLineLen--;
+	WgetLine[WgetLineLen] = '\0';
+	WgetLineLen = 0;
+
+	return WgetHandleLine(WgetLine) ? -1 : n;
+}
+
+static int WgetRecv(ulong offset, uchar *data, unsigned len)
+{
+	int n;
+
+	while (len) {
+		switch (WgetState) {
+		case WGET_BODY:
+			n = len;
+			if (WgetHaveLength)
+				n = min((ulong)n,
+					WgetContentLength - WgetBodyLen);
+			if (WgetStore(WgetBodyLen, data, n))
+				goto fail;
+			WgetBodyLen += n;
+			WgetProgress();
+			if (WgetHaveLength && WgetBodyLen == WgetContentLength)
+				WgetComplete();
+			break;
+
+		case WGET_CHUNK_DATA:
+			n = min((ulong)len, WgetChunkLeft);
+			if (WgetStore(WgetBodyLen, data, n))
+				goto fail;
+			WgetBodyLen += n;
+			WgetProgress();
+			WgetChunkLeft -= n;
+			if (WgetChunkLeft == 0)
+				WgetState = WGET_CHUNK_END;
+			break;
+
+		case WGET_DONE:
+			/* Nothing should follow the body */
+			n = len;
+			break;
+
+		default:
+			n = WgetLineInput(data, len);
+			if (n < 0)
+				goto fail;
+			break;
+		}
+
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+
+fail:
+	NetState = NETLOOP_FAIL;
+	return -1;
+}
+
+static void WgetEvent(int event)
+{
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		if (TcpSend((uchar *)WgetRequest, WgetRequestLen)) {
+			puts("\nHTTP request too long\n");
+			TcpAbort();
+			NetState = NETLOOP_FAIL;
+		}
+		break;
+
+	case TCP_EV_EOF:
+		/* Without a length the body ends with the connection */
+		if (WgetState == WGET_BODY && !WgetHaveLength)
+			WgetState = WGET_DONE;
+		TcpClose();
+		break;
+
+	default:
+		/* The connection is gone */
+		if (WgetState == WGET_DONE) {
+			WgetDone();
+		} else if (event == TCP_EV_TIMEOUT) {
+			puts("\nRetry count exceeded; starting again\n");
+			NetStartAgain();
+		} else {
+			puts(event == TCP_EV_RESET ? "\nConnection reset\n" :
+				"\nConnection closed early\n");
+			NetState = NETLOOP_FAIL;
+		}
+		break;
+	}
+}
+
+/* HTTP runs over TCP; UDP that reaches us meanwhile is not ours */
+static void WgetUdpHandler(uchar *pkt, unsigned dest, unsigned src,
+			   unsigned len)
+{
+	/* nothing */
+}
+
+void WgetStart(void)
+{
+	if (WgetParseURL()) {
+		NetState = NETLOOP_FAIL;
+		return;
+	}
+
+#if defined(CONFIG_NET_MULTI)
+	printf("Using %s device\n", eth_get_name());
+#endif
+	printf("HTTP from server %pI4"
+		"; our IP address is %pI4", &WgetServerIP, &NetOurIP);
+
+	/* Check if we need to send across this subnet */
+	if (NetOurGatewayIP && NetOurSubnetMask) {
+		IPaddr_t OurNet	= NetOurIP     & NetOurSubnetMask;
+		IPaddr_t ServerNet	= WgetServerIP & NetOurSubnetMask;
+
+		if (OurNet != ServerNet)
+			printf("; sending through gateway %pI4",
+				&NetOurGatewayIP);
+	}
+	putc('\n');
+
+	printf("URL 'http://%s%s'.\n", WgetHost, WgetPath);
+
+#ifdef CONFIG_SPI_FLASH_STREAM
+	if (NetFlashStream) {
+		printf("Flash offset: 0x%x\n", NetFlashStream->base);
+		spi_flash_stream_rewind(NetFlashStream);
+	} else
+#endif
+	printf("Load address: 0x%lx\n", load_addr);
+
+	puts("Loading: *\b");
+
+	/* WgetPath and WgetHost are short enough for this to fit */
+	WgetRequestLen = sprintf(WgetRequest,
+		"GET %s HTTP/1.1\r\n"
+		"Host: %s\r\n"
+		"User-Agent: U-Boot\r\n"
+		"Connection: close\r\n"
+		"\r\n", WgetPath, WgetHost);
+
+	WgetState = WGET_STATUS;
+	WgetLineLen = 0;
+	WgetBodyLen = 0;
+	WgetContentLength = 0;
+	WgetHaveLength = 0;
+	WgetChunked = 0;
+	WgetNextHash = WGET_HASH_BYTES;
+	WgetHashes = 0;
+	WgetStartTime = get_timer(0);
+
+	NetSetHandler(WgetUdpHandler);
+	TcpConnect(WgetServerIP, WgetServerPort, WgetRecv, WgetEvent);
+}
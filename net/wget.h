@@ -0,0 +1,20 @@
+/*
+ * HTTP download over TCP
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+#define WGET_DEFAULT_PORT	80
+
+extern void	WgetStart(void);	/* Begin HTTP GET of BootFile */
+
+#endif /* __WGET_H__ */
@@ -0,0 +1,275 @@
+/*
+ * Check and time the slicing-by-4/8 crc32() (CONFIG_CRC32_SLICING)
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * lib/crc32.c is built here five times: without slicing (the byte-wise
+ * table code, as the baseline), and with slicing-by-4 and -by-8 each
+ * for a little-endian and for a big-endian target.
+ *
+ * The big-endian builds run on the (little-endian) host with
+ * __BYTE_ORDER, cpu_to_le32() and le32_to_cpu() set as on a big-endian
+ * target, and with the word loads of the slicing loops byte swapped,
+ * which is what a big-endian core reads for the same bytes in memory.
+ * Byte loads are the same either way, so this runs exactly the
+ * arithmetic of the big-endian path.
+ *
+ * Every build is checked against a bit-at-a-time CRC for every buffer
+ * alignment 0..7 and every length up to 300 plus a few long ones, with
+ * several starting values; crc32_no_comp() and memcpy_crc32() are
+ * checked as well.  Then the little-endian builds are timed.
+ *
+ *	crc32_test [-n]		(-n skips the timing)
+ */
+
+#include <compiler.h>
+#include <u-boot/crc.h>
+#include "u-boot/zlib.h"
+#include <time.h>
+
+#if __BYTE_ORDER != __LITTLE_ENDIAN
+#error "crc32_test expects a little-endian build host"
+#endif
+
+/* Give each build of lib/crc32.c its own names */
+#define CRC_CAT(pfx, name)	pfx##_##name
+#define CRC_XCAT(pfx, name)	CRC_CAT(pfx, name)
+#define crc32			CRC_XCAT(CRC_PFX, crc32)
+#define crc32_no_comp		CRC_XCAT(CRC_PFX, crc32_no_comp)
+#define crc32_wd		CRC_XCAT(CRC_PFX, crc32_wd)
+#define memcpy_crc32		CRC_XCAT(CRC_PFX, memcpy_crc32)
+#define memcpy_crc32_wd		CRC_XCAT(CRC_PFX, memcpy_crc32_wd)
+#define crc_table		CRC_XCAT(CRC_PFX, crc_table)
+#define crc_slice_empty		CRC_XCAT(CRC_PFX, crc_slice_empty)
+#define crc_slice_table		CRC_XCAT(CRC_PFX, crc_slice_table)
+#define make_crc_slice_table	CRC_XCAT(CRC_PFX, make_crc_slice_table)
+
+#define CRC_PFX			ref
+#include "../lib/crc32.c"
+#undef CRC_PFX
+
+#define CONFIG_CRC32_SLICING	4
+#define CRC_PFX			s4le
+#include "../lib/crc32.c"
+#undef CRC_PFX
+#undef CONFIG_CRC32_SLICING
+
+#define CONFIG_CRC32_SLICING	8
+#define CRC_PFX			s8le
+#include "../lib/crc32.c"
+#undef CRC_PFX
+#undef CONFIG_CRC32_SLICING
+
+/* Big-endian target: swapped word loads and LE conversions */
+static inline uint32_t be_word (const uint32_t *p)
+{
+	uint32_t x = *p;
+
+	return uswap_32(x);
+}
+
+#undef __BYTE_ORDER
+#define __BYTE_ORDER		__BIG_ENDIAN
+#undef cpu_to_le32
+#undef le32_to_cpu
+#define cpu_to_le32(x)		uswap_32(x)
+#define le32_to_cpu(x)		uswap_32(x)
+
+#define CONFIG_CRC32_SLICING	4
+#define CRC_PFX			s4be
+#define CRC_WORD(p)		be_word(p)
+#include "../lib/crc32.c"
+#undef CRC_PFX
+#undef CONFIG_CRC32_SLICING
+
+#define CONFIG_CRC32_SLICING	8
+#define CRC_PFX			s8be
+#define CRC_WORD(p)		be_word(p)
+#include "../lib/crc32.c"
+#undef CRC_PFX
+#undef CONFIG_CRC32_SLICING
+
+#undef __BYTE_ORDER
+#define __BYTE_ORDER		__LITTLE_ENDIAN
+#undef cpu_to_le32
+#undef le32_to_cpu
+#define cpu_to_le32(x)		(x)
+#define le32_to_cpu(x)		(x)
+
+#undef crc32
+#undef crc32_no_comp
+#undef crc32_wd
+#undef memcpy_crc32
+#undef memcpy_crc32_wd
+#undef crc_table
+#undef crc_slice_empty
+#undef crc_slice_table
+#undef make_crc_slice_table
+
+static const struct {
+	const char *name;
+	uint32_t (*crc)(uint32_t, const Bytef *, uInt);
+	uint32_t (*no_comp)(uint32_t, const Bytef *, uInt);
+	uint32_t (*copy)(uint32_t, void *, const void *, uInt);
+} builds[] = {
+	{ "table",     ref_crc32,  ref_crc32_no_comp,  ref_memcpy_crc32 },
+	{ "slice4 LE", s4le_crc32, s4le_crc32_no_comp, s4le_memcpy_crc32 },
+	{ "slice8 LE", s8le_crc32, s8le_crc32_no_comp, s8le_memcpy_crc32 },
+	{ "slice4 BE", s4be_crc32, s4be_crc32_no_comp, s4be_memcpy_crc32 },
+	{ "slice8 BE", s8be_crc32, s8be_crc32_no_comp, s8be_memcpy_crc32 },
+};
+#define NBUILDS		(sizeof(builds) / sizeof(builds[0]))
+
+/* One bit at a time, straight from the polynomial */
+static uint32_t bit_crc32_no_comp (uint32_t crc, const uint8_t *p, size_t len)
+{
+	int k;
+
+	while (len--) {
+		crc ^= *p++;
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return crc;
+}
+
+#define MAX_ALIGN	8
+#define MAX_LEN		300
+
+static const size_t long_lens[] = { 1024, 1513, 1514, 4096, 65535, 65536 };
+static const uint32_t seeds[] = { 0, 0xffffffff, 0x12345678, 0x80000001 };
+
+static uint32_t buf_w[(65536 + MAX_ALIGN) / 4 + 1];
+static uint32_t copy_w[(65536 + MAX_ALIGN) / 4 + 1];
+static uint8_t *buf = (uint8_t *)buf_w;
+
+static int errors;
+
+static void check (int b, const char *what, int off, size_t len,
+		   uint32_t seed, uint32_t got, uint32_t want)
+{
+	if (got != want && errors++ < 20)
+		fprintf(stderr, "%s %s: offset %d len %u seed %08x: "
+			"%08x, expected %08x\n", builds[b].name, what, off,
+			(unsigned)len, seed, got, want);
+}
+
+static void test_one (int off, size_t len)
+{
+	uint8_t *p = buf + off;
+	uint8_t *d = (uint8_t *)copy_w + (off ^ 3);
+	int b, s;
+
+	for (s = 0; s < sizeof(seeds) / sizeof(seeds[0]); s++) {
+		uint32_t raw = bit_crc32_no_comp(seeds[s], p, len);
+		uint32_t want = bit_crc32_no_comp(seeds[s] ^ 0xffffffff,
+						  p, len) ^ 0xffffffff;
+
+		for (b = 0; b < NBUILDS; b++) {
+			check(b, "crc32_no_comp", off, len, seeds[s],
+			      builds[b].no_comp(seeds[s], p, len), raw);
+			check(b, "crc32", off, len, seeds[s],
+			      builds[b].crc(seeds[s], p, len), want);
+		}
+	}
+
+	/* memcpy_crc32(), also checking what it copied */
+	for (b = 0; b < NBUILDS; b++) {
+		uint32_t want = builds[0].crc(0, p, len);
+
+		memset(copy_w, 0, sizeof(copy_w));
+		check(b, "memcpy_crc32", off, len, 0,
+		      builds[b].copy(0, d, p, len), want);
+		if (memcmp(d, p, len))
+			check(b, "memcpy_crc32 copy", off, len, 0, 1, 0);
+	}
+}
+
+static double now_ns (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define BENCH_BYTES	(256 << 20)	/* checksummed per measurement */
+
+static double bench (uint32_t (*volatile fn)(uint32_t, const Bytef *, uInt),
+		     size_t size, int off)
+{
+	volatile uint32_t sink;
+	long n, loops = BENCH_BYTES / size;
+	uint32_t crc = 0;
+	double t0 = now_ns();
+
+	for (n = 0; n < loops; n++)
+		crc = fn(crc, buf + off, size);
+	sink = crc;
+	(void)sink;
+	return (double)loops * size / (now_ns() - t0) * 1e3;	/* MB/s */
+}
+
+int main (int argc, char **argv)
+{
+	static const size_t sizes[] = { 64, 1514, 16384, 65536 };
+	size_t len;
+	int off, b, i;
+
+	for (i = 0; i < sizeof(buf_w); i++)
+		buf[i] = (uint8_t)(i * 13 + (i >> 8) + (i >> 16));
+
+	for (off = 0; off < MAX_ALIGN; off++) {
+		for (len = 0; len <= MAX_LEN; len++)
+			test_one(off, len);
+		for (i = 0; i < sizeof(long_lens) / sizeof(long_lens[0]); i++)
+			test_one(off, long_lens[i]);
+	}
+
+	if (errors) {
+		fprintf(stderr, "%d errors\n", errors);
+		return EXIT_FAILURE;
+	}
+	printf("table, slice4/8 LE and BE: alignments 0..%d, "
+		"lengths 0..%d and up to 64K: OK\n", MAX_ALIGN - 1, MAX_LEN);
+
+	if (argc > 1 && strcmp(argv[1], "-n") == 0)
+		return EXIT_SUCCESS;
+
+	printf("\n%8s %6s", "size", "offset");
+	for (b = 0; b < 3; b++)
+		printf(" %14s", builds[b].name);
+	printf("\n");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	for (off = 0; off < 2; off++) {
+		double t = bench(builds[0].crc, sizes[i], off);
+
+		printf("%8u %6d %9.0f MB/s", (unsigned)sizes[i], off, t);
+		for (b = 1; b < 3; b++) {
+			double s = bench(builds[b].crc, sizes[i], off);
+
+			printf(" %5.0f (%.1fx)", s, s / t);
+		}
+		printf("\n");
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+/*
+ * Time getenv() lookups with and without the hash index (CONFIG_ENV_HASH)
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Builds an environment shaped like the one on a deployed board (the
+ * default variables plus the image layout variables lib_labx/preboot.c
+ * checks), pads it with extra variables, and replays the lookups the
+ * boot path makes: main_loop(), the preboot CRC checks and the hush
+ * expansion of the boot script.  Each lookup is done with the linear
+ * walk getenv() used before and with common/env_hash.c, and the results
+ * are checked against each other.
+ *
+ *	env_hash_bench [extra variables ...]
+ *
+ * Alternatively "-f file" reads the environment from the output of
+ * "printenv" saved on a board.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef __ASSEMBLY__
+#define	__ASSEMBLY__			/* Dirty trick to get only #defines	*/
+#endif
+#define	__ASM_STUB_PROCESSOR_H__	/* don't include asm/processor.		*/
+#include <config.h>
+#undef	__ASSEMBLY__
+#include <environment.h>
+
+#define BENCH_ENV_SIZE	0x8000
+
+static unsigned char env_buf[BENCH_ENV_SIZE];
+static int env_len;
+
+static const char *base_env[] = {
+	"bootcmd=run bootlnx",
+	"bootdelay=1",
+	"baudrate=115200",
+	"hostname=labx-essex",
+	"ipaddr=192.168.1.1",
+	"serverip=192.168.1.100",
+	"ethaddr=00:0A:35:00:33:01",
+	"netmask=255.255.255.0",
+	"loadaddr=0x88000000",
+	"fdtaddr=0x88f00000",
+	"bootargs=console=ttyUL0,115200 root=/dev/mtdblock3 rootfstype=squashfs",
+	"bootlnx=sf probe 0; sf read ${loadaddr} ${kernstart} ${kernsize}; "
+		"sf read ${fdtaddr} ${fdtstart} ${fdtsize}; "
+		"bootm ${loadaddr} - ${fdtaddr}",
+	"bootglnx=sf probe 0; sf read ${loadaddr} ${goldenkernstart} "
+		"${goldenkernsize}; sf read ${fdtaddr} ${goldenfdtstart} "
+		"${goldenfdtsize}; bootm ${loadaddr} - ${fdtaddr}",
+	"stdin=serial",
+	"stdout=serial",
+	"stderr=serial",
+	NULL
+};
+
+/* Start, size and header variables of each image preboot checks */
+static const char *images[] = {
+	"bootfpga", "goldenfdt", "boot", "goldenkern", "goldenrootfs",
+	"goldenromfs", "fpga", "fdt", "kern", "rootfs", "romfs", NULL
+};
+
+/* Lookups made on the way to the kernel, in order */
+static const char *boot_lookups[] = {
+	/* board_init_r(), console and network setup */
+	"ethaddr", "ipaddr", "serverip", "stdin", "stdout", "stderr",
+	"loadaddr", "bootfile", "verify",
+	/* main_loop() */
+	"bootlimit", "preboot", "bootdelay", "bootdelaykey", "bootdelaykey2",
+	"bootstopkey", "bootstopkey2", "failbootcmd", "altbootcmd", "bootcmd",
+	/* labx_preboot() CRC checks of the production images */
+	"fpgastart", "fpgahdr", "fpgasize", "fdtstart", "fdthdr", "fdtsize",
+	"kernstart", "kernsize", "rootfsstart", "rootfshdr", "rootfssize",
+	"romfsstart", "romfshdr", "romfssize",
+	/* hush: "run bootlnx" and the expansion of its commands */
+	"bootlnx", "loadaddr", "kernstart", "kernsize", "fdtaddr",
+	"fdtstart", "fdtsize", "loadaddr", "fdtaddr",
+	/* bootm */
+	"verify", "autostart", "bootm_low", "bootm_size", "bootm_mapsize",
+	"fdt_high", "initrd_high", "bootargs", "silent",
+	NULL
+};
+
+static void env_add (const char *entry)
+{
+	int len = strlen(entry) + 1;
+
+	if (env_len + len + 1 > BENCH_ENV_SIZE) {
+		fprintf(stderr, "environment full\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(env_buf + env_len, entry, len);
+	env_len += len;
+	env_buf[env_len] = '\0';
+}
+
+static void env_make (int extra)
+{
+	char entry[64];
+	int i;
+
+	for (i = 0; base_env[i]; i++)
+		env_add(base_env[i]);
+	for (i = 0; images[i]; i++) {
+		sprintf(entry, "%sstart=0x%06x", images[i], 0x100000 * i);
+		env_add(entry);
+		sprintf(entry, "%ssize=0x%06x", images[i], 0x0e0000);
+		env_add(entry);
+		sprintf(entry, "%shdr=0x%06x", images[i], 0x100000 * i + 0xe0000);
+		env_add(entry);
+	}
+	for (i = 0; i < extra; i++) {
+		sprintf(entry, "var%03d=value of extra variable %d", i, i);
+		env_add(entry);
+	}
+}
+
+static void env_read (const char *file)
+{
+	char line[1024];
+	FILE *f = fopen(file, "r");
+
+	if (!f) {
+		perror(file);
+		exit(EXIT_FAILURE);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (strchr(line, '=') && line[0] != '=')
+			env_add(line);
+	}
+	fclose(f);
+}
+
+/*
+ * The linear walk getenv() does without the index, reading through
+ * env_get_char() one character at a time as it does on the target.
+ */
+static unsigned char (*env_get_char_p)(int);
+
+static unsigned char bench_get_char (int index)
+{
+	return env_buf[index];
+}
+
+static int linear_match (const unsigned char *s1, int i2)
+{
+	while (*s1 == env_get_char_p(i2++))
+		if (*s1++ == '=')
+			return i2;
+	if (*s1 == '\0' && env_get_char_p(i2 - 1) == '=')
+		return i2;
+	return -1;
+}
+
+static int linear_find (const char *name)
+{
+	int i, nxt, val;
+
+	for (i = 0; env_get_char_p(i) != '\0'; i = nxt + 1) {
+		for (nxt = i; env_get_char_p(nxt) != '\0'; ++nxt) {
+			if (nxt >= BENCH_ENV_SIZE)
+				return -1;
+		}
+		if ((val = linear_match((const unsigned char *)name, i)) >= 0)
+			return val;
+	}
+
+	return -1;
+}
+
+static double now_ns (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main (int argc, char **argv)
+{
+	volatile int sink = 0;
+	double t0, t_lin, t_hash;
+	int i, n, loops, lookups, vars;
+
+	env_get_char_p = bench_get_char;
+
+	if (argc > 2 && strcmp(argv[1], "-f") == 0)
+		env_read(argv[2]);
+	else
+		env_make(argc > 1 ? atoi(argv[1]) : 0);
+
+	for (vars = 0, i = 0; i < env_len; i++)
+		vars += env_buf[i] == '\0';
+
+	if (env_hash_build(env_buf, BENCH_ENV_SIZE)) {
+		fprintf(stderr, "%d variables: too many for the index\n", vars);
+		return EXIT_FAILURE;
+	}
+
+	/* Both must agree, for present and missing variables alike */
+	for (lookups = 0; boot_lookups[lookups]; lookups++) {
+		const char *name = boot_lookups[lookups];
+
+		if (linear_find(name) != env_hash_find(env_buf, name)) {
+			fprintf(stderr, "mismatch for \"%s\"\n", name);
+			return EXIT_FAILURE;
+		}
+	}
+
+	loops = 20000;
+	t0 = now_ns();
+	for (n = 0; n < loops; n++)
+		for (i = 0; i < lookups; i++)
+			sink += linear_find(boot_lookups[i]);
+	t_lin = now_ns() - t0;
+
+	t0 = now_ns();
+	for (n = 0; n < loops; n++)
+		for (i = 0; i < lookups; i++)
+			sink += env_hash_find(env_buf, boot_lookups[i]);
+	t_hash = now_ns() - t0;
+
+	printf("%d variables, %d bytes; %d lookups per boot\n",
+		vars, env_len + 1, lookups);
+	printf("linear: %8.0f ns per boot, %6.1f ns per lookup\n",
+		t_lin / loops, t_lin / loops / lookups);
+	printf("hashed: %8.0f ns per boot, %6.1f ns per lookup (%.1fx)\n",
+		t_hash / loops, t_hash / loops / lookups, t_lin / t_hash);
+
+	return EXIT_SUCCESS;
+}
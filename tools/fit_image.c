@@ -47,6 +47,94 @@ static int fit_check_image_types (uint8_t type)
 		return EXIT_FAILURE;
 }
 
+/**
+ * fit_extract_data - move image data out of the FIT structure
+ *
+ * fit_extract_data() replaces the data property of every component image
+ * by data-offset and data-size properties and stores the data after the
+ * structure, starting at the next 4 byte boundary, so that a loader can
+ * read the structure alone and then only the image data it needs.
+ *
+ * tfd - FIT file, rewritten in place
+ *
+ * returns:
+ *     EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int fit_extract_data (struct mkimage_params *params, int tfd)
+{
+	struct stat sbuf;
+	unsigned char *fit = NULL, *buf = NULL, *data = NULL;
+	const void *prop;
+	uint32_t data_len = 0, val;
+	int images_noffset, noffset, ndepth, len, padded, size;
+	int ret = EXIT_FAILURE;
+	static const unsigned char pad[4];
+
+	if (fstat (tfd, &sbuf) < 0)
+		goto err;
+
+	/* room for the data-offset and data-size properties */
+	size = sbuf.st_size + 1024;
+	fit = malloc (sbuf.st_size);
+	buf = malloc (size);
+	data = malloc (sbuf.st_size);
+	if (!fit || !buf || !data)
+		goto err;
+
+	if (pread (tfd, fit, sbuf.st_size, 0) != sbuf.st_size ||
+	    fdt_open_into (fit, buf, size))
+		goto err;
+
+	images_noffset = fdt_path_offset (buf, FIT_IMAGES_PATH);
+	if (images_noffset < 0)
+		goto err;
+
+	for (ndepth = 0, noffset = fdt_next_node (buf, images_noffset, &ndepth);
+	     (noffset >= 0) && (ndepth > 0);
+	     noffset = fdt_next_node (buf, noffset, &ndepth)) {
+		if (ndepth != 1)
+			continue;
+
+		prop = fdt_getprop (buf, noffset, FIT_DATA_PROP, &len);
+		if (!prop)
+			continue;
+
+		padded = (len + 3) & ~3;
+		memcpy (data + data_len, prop, len);
+		memset (data + data_len + len, 0, padded - len);
+
+		val = cpu_to_uimage (data_len);
+		if (fdt_delprop (buf, noffset, FIT_DATA_PROP) ||
+		    fdt_setprop (buf, noffset, FIT_DATA_OFFSET_PROP,
+				&val, sizeof (val)))
+			goto err;
+		val = cpu_to_uimage (len);
+		if (fdt_setprop (buf, noffset, FIT_DATA_SIZE_PROP,
+				&val, sizeof (val)))
+			goto err;
+
+		data_len += padded;
+	}
+
+	if (fdt_pack (buf) ||
+	    ftruncate (tfd, 0) ||
+	    pwrite (tfd, buf, fdt_totalsize (buf), 0) != fdt_totalsize (buf) ||
+	    pwrite (tfd, pad, fit_get_ext_base (buf) - fdt_totalsize (buf),
+			fdt_totalsize (buf)) < 0 ||
+	    pwrite (tfd, data, data_len, fit_get_ext_base (buf)) != data_len)
+		goto err;
+
+	ret = EXIT_SUCCESS;
+err:
+	if (ret != EXIT_SUCCESS)
+		fprintf (stderr, "%s: Can't move image data out of the FIT\n",
+				params->cmdname);
+	free (fit);
+	free (buf);
+	free (data);
+	return ret;
+}
+
 /**
  * fit_handle_file - main FIT file processing function
  *
@@ -142,6 +230,12 @@ static int fit_handle_file (struct mkimage_params *params)
 	debug ("Added timestamp successfully\n");
 
 	munmap ((void *)ptr, sbuf.st_size);
+
+	if (params->Eflag && fit_extract_data (params, tfd)) {
+		close (tfd);
+		unlink (tmpfile);
+		return (EXIT_FAILURE);
+	}
 	close (tfd);
 
 	if (rename (tmpfile, params->imagefile) == -1) {
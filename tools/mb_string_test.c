@@ -0,0 +1,387 @@
+/*
+ * Check and time the MicroBlaze memcpy/memmove/memset on the build host
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * arch/microblaze/lib/string.c is built here twice, once as for a
+ * little-endian core and once as for a big-endian one, with the barrel
+ * shifter enabled so that the shift-and-merge path is used.
+ *
+ * The little-endian build runs natively and is checked against a byte
+ * by byte reference for every source and destination alignment and
+ * every length up to well past the unrolled loops, overlapping moves in
+ * both directions included.
+ *
+ * Only copy_words_merge() depends on the byte order; the byte copies
+ * and the whole word copies move the same bytes either way.  The
+ * big-endian merge is checked by laying the source out in memory as a
+ * big-endian core sees it (every aligned word byte swapped), running
+ * the big-endian build of copy_words_merge() over it and swapping the
+ * result back, for every source alignment and word count.
+ *
+ * Finally memcpy() and memset() are timed against the generic versions
+ * from lib/string.c.
+ *
+ *	mb_string_test [-n]	(-n skips the timing)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Keep the host compiler from turning the byte and word loops under
+ * test into calls to its own memcpy()/memset().
+ */
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6))
+#pragma GCC optimize ("no-tree-loop-distribute-patterns")
+#endif
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef unsigned long ulong;
+
+#define XPAR_MICROBLAZE_USE_BARREL	1
+
+/* Little-endian build, run as is */
+#define __MICROBLAZEEL__
+#define memcpy			le_memcpy
+#define memmove			le_memmove
+#define memset			le_memset
+#define copy_words_fwd		le_copy_words_fwd
+#define copy_words_bwd		le_copy_words_bwd
+#define copy_words_merge	le_copy_words_merge
+#include "../arch/microblaze/lib/string.c"
+#undef __MICROBLAZEEL__
+#undef memcpy
+#undef memmove
+#undef memset
+#undef copy_words_fwd
+#undef copy_words_bwd
+#undef copy_words_merge
+#undef MB_SHIFT_MERGE
+#undef MERGE
+#undef MB_STRING_THRESHOLD
+
+/* Big-endian build, of which only copy_words_merge() is run */
+#define memcpy			be_memcpy
+#define memmove			be_memmove
+#define memset			be_memset
+#define copy_words_fwd		be_copy_words_fwd
+#define copy_words_bwd		be_copy_words_bwd
+#define copy_words_merge	be_copy_words_merge
+#include "../arch/microblaze/lib/string.c"
+#undef memcpy
+#undef memmove
+#undef memset
+#undef copy_words_fwd
+#undef copy_words_bwd
+#undef copy_words_merge
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "mb_string_test expects a little-endian build host"
+#endif
+
+/*
+ * The generic versions from lib/string.c, as the baseline, with the
+ * 32 bit unsigned long of the target
+ */
+static void *generic_memcpy (void *dest, const void *src, size_t count)
+{
+	u32 *dl = (u32 *)dest, *sl = (u32 *)src;
+	char *d8, *s8;
+
+	if ((((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+		while (count >= sizeof(*dl)) {
+			*dl++ = *sl++;
+			count -= sizeof(*dl);
+		}
+	}
+	d8 = (char *)dl;
+	s8 = (char *)sl;
+	while (count--)
+		*d8++ = *s8++;
+
+	return dest;
+}
+
+static void *generic_memset (void *s, int c, size_t count)
+{
+	u32 *sl = (u32 *)s;
+	u32 cl = 0;
+	char *s8;
+	int i;
+
+	if (((ulong)s & (sizeof(*sl) - 1)) == 0) {
+		for (i = 0; i < sizeof(*sl); i++) {
+			cl <<= 8;
+			cl |= c & 0xff;
+		}
+		while (count >= sizeof(*sl)) {
+			*sl++ = cl;
+			count -= sizeof(*sl);
+		}
+	}
+	s8 = (char *)sl;
+	while (count--)
+		*s8++ = c;
+
+	return s;
+}
+
+#define MAX_ALIGN	8	/* two words either side of an aligned start */
+#define MAX_LEN		300	/* past several rounds of every unrolled loop */
+#define GUARD		0xa5
+#define BUF_WORDS	((MAX_LEN + 4 * MAX_ALIGN + 64) / 4)
+
+/* Word arrays, so the routines' word accesses are to u32 objects */
+static u32 src_w[BUF_WORDS], dst_w[BUF_WORDS], ref_w[BUF_WORDS];
+static u8 *src = (u8 *)src_w, *dst = (u8 *)dst_w, *ref = (u8 *)ref_w;
+
+static int errors;
+
+static void fail (const char *what, int soff, int doff, int len, int at)
+{
+	if (errors++ < 20)
+		fprintf(stderr, "%s: src+%d dst+%d len %d: wrong byte at %d\n",
+			what, soff, doff, len, at);
+}
+
+static void fill (u8 *buf, int seed)
+{
+	int i;
+
+	for (i = 0; i < BUF_WORDS * 4; i++)
+		buf[i] = (u8)(i * 7 + seed + (i >> 8));
+}
+
+static int compare (const u8 *a, const u8 *b)
+{
+	int i;
+
+	for (i = 0; i < BUF_WORDS * 4; i++)
+		if (a[i] != b[i])
+			return i;
+	return -1;
+}
+
+static void test_memcpy (void)
+{
+	int soff, doff, len, i, at;
+
+	fill(src, 1);
+	for (soff = 0; soff < MAX_ALIGN; soff++)
+	for (doff = 0; doff < MAX_ALIGN; doff++)
+	for (len = 0; len <= MAX_LEN; len++) {
+		for (i = 0; i < BUF_WORDS * 4; i++)
+			dst[i] = ref[i] = GUARD;
+		for (i = 0; i < len; i++)
+			ref[doff + i] = src[soff + i];
+
+		if (le_memcpy(dst + doff, src + soff, len) != dst + doff)
+			fail("memcpy return", soff, doff, len, 0);
+		if ((at = compare(dst, ref)) >= 0)
+			fail("memcpy", soff, doff, len, at);
+	}
+}
+
+static void test_memmove (void)
+{
+	int soff, doff, len, i, at;
+
+	/* Source and destination in the same buffer, up to 12 bytes apart */
+	for (soff = 0; soff < MAX_ALIGN + 12; soff++)
+	for (doff = 0; doff < MAX_ALIGN + 12; doff++)
+	for (len = 0; len <= MAX_LEN; len++) {
+		fill(dst, 3);
+		fill(ref, 3);
+		for (i = 0; i < len; i++)
+			src[i] = ref[soff + i];
+		for (i = 0; i < len; i++)
+			ref[doff + i] = src[i];
+
+		if (le_memmove(dst + doff, dst + soff, len) != dst + doff)
+			fail("memmove return", soff, doff, len, 0);
+		if ((at = compare(dst, ref)) >= 0)
+			fail("memmove", soff, doff, len, at);
+	}
+}
+
+static void test_memset (void)
+{
+	static const int values[] = { 0x00, 0xff, 0x5a, 0x1a5, -1 };
+	int doff, len, v, i, at;
+
+	for (v = 0; v < sizeof(values) / sizeof(values[0]); v++)
+	for (doff = 0; doff < MAX_ALIGN; doff++)
+	for (len = 0; len <= MAX_LEN; len++) {
+		for (i = 0; i < BUF_WORDS * 4; i++)
+			dst[i] = ref[i] = GUARD;
+		for (i = 0; i < len; i++)
+			ref[doff + i] = (u8)values[v];
+
+		if (le_memset(dst + doff, values[v], len) != dst + doff)
+			fail("memset return", values[v], doff, len, 0);
+		if ((at = compare(dst, ref)) >= 0)
+			fail("memset", values[v], doff, len, at);
+	}
+}
+
+/* Byte swap every aligned word: memory as seen by the other byte order */
+static void swap_words (u32 *w, int words)
+{
+	while (words--) {
+		u32 x = *w;
+
+		*w++ = (x >> 24) | ((x >> 8) & 0xff00) |
+		       ((x << 8) & 0xff0000) | (x << 24);
+	}
+}
+
+static void test_merge_be (void)
+{
+	int soff, words, i, at;
+
+	fill(src, 5);
+	for (soff = 1; soff < 4; soff++)
+	for (words = 0; words <= MAX_LEN / 4; words++) {
+		for (i = 0; i < BUF_WORDS * 4; i++)
+			dst[i] = ref[i] = GUARD;
+		for (i = 0; i < words * 4; i++)
+			ref[i] = src[soff + i];
+
+		swap_words(src_w, BUF_WORDS);
+		swap_words(dst_w, BUF_WORDS);
+		be_copy_words_merge(dst_w, src + soff, words);
+		swap_words(dst_w, BUF_WORDS);
+		swap_words(src_w, BUF_WORDS);
+
+		if ((at = compare(dst, ref)) >= 0)
+			fail("merge (BE)", soff, 0, words * 4, at);
+	}
+
+	/* The little-endian merge over the same data, for symmetry */
+	for (soff = 1; soff < 4; soff++)
+	for (words = 0; words <= MAX_LEN / 4; words++) {
+		for (i = 0; i < BUF_WORDS * 4; i++)
+			dst[i] = ref[i] = GUARD;
+		for (i = 0; i < words * 4; i++)
+			ref[i] = src[soff + i];
+
+		le_copy_words_merge(dst_w, src + soff, words);
+		if ((at = compare(dst, ref)) >= 0)
+			fail("merge (LE)", soff, 0, words * 4, at);
+	}
+}
+
+static double now_ns (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define BENCH_BYTES	(256 << 20)	/* moved per measurement */
+
+static u32 bench_src[(1 << 20) / 4 + 4], bench_dst[(1 << 20) / 4 + 4];
+
+/* Called through volatile pointers so that neither side is inlined */
+static double bench_copy (void *(*volatile fn)(void *, const void *, size_t),
+			  int size, int soff, int doff)
+{
+	u8 *s = (u8 *)bench_src + soff, *d = (u8 *)bench_dst + doff;
+	long n, loops = BENCH_BYTES / size;
+	double t0 = now_ns();
+
+	for (n = 0; n < loops; n++)
+		fn(d, s, size);
+	return (double)loops * size / (now_ns() - t0) * 1e3;	/* MB/s */
+}
+
+static double bench_set (void *(*volatile fn)(void *, int, size_t),
+			 int size, int doff)
+{
+	u8 *d = (u8 *)bench_dst + doff;
+	long n, loops = BENCH_BYTES / size;
+	double t0 = now_ns();
+
+	for (n = 0; n < loops; n++)
+		fn(d, n, size);
+	return (double)loops * size / (now_ns() - t0) * 1e3;
+}
+
+static void bench (void)
+{
+	/* Header, full frame, a TFTP block run, an image chunk */
+	static const int sizes[] = { 64, 1514, 16384, 1 << 20 };
+	static const int offs[][2] = { { 0, 0 }, { 2, 0 }, { 1, 3 } };
+	int i, j;
+
+	printf("\n%8s %8s %10s %10s\n", "memcpy", "src/dst", "generic", "mb");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	for (j = 0; j < sizeof(offs) / sizeof(offs[0]); j++) {
+		double g = bench_copy(generic_memcpy, sizes[i],
+				      offs[j][0], offs[j][1]);
+		double m = bench_copy(le_memcpy, sizes[i],
+				      offs[j][0], offs[j][1]);
+
+		printf("%8d %6d/%d %7.0f MB/s %7.0f MB/s (%.1fx)\n", sizes[i],
+			offs[j][0], offs[j][1], g, m, m / g);
+	}
+
+	printf("\n%8s %8s %10s %10s\n", "memset", "dst", "generic", "mb");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	for (j = 0; j < 2; j++) {
+		double g = bench_set(generic_memset, sizes[i], j);
+		double m = bench_set(le_memset, sizes[i], j);
+
+		printf("%8d %8d %7.0f MB/s %7.0f MB/s (%.1fx)\n", sizes[i],
+			j, g, m, m / g);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	test_memcpy();
+	test_memmove();
+	test_memset();
+	test_merge_be();
+
+	if (errors) {
+		fprintf(stderr, "%d errors\n", errors);
+		return EXIT_FAILURE;
+	}
+	printf("memcpy, memmove, memset: alignments 0..%d, lengths 0..%d: OK\n",
+		MAX_ALIGN - 1, MAX_LEN);
+	printf("big-endian merge: source alignments 1..3, 0..%d words: OK\n",
+		MAX_LEN / 4);
+
+	if (argc > 1 && strcmp(argv[1], "-n") == 0)
+		return EXIT_SUCCESS;
+
+	bench();
+
+	return EXIT_SUCCESS;
+}
@@ -56,6 +56,7 @@
 struct mkimage_params {
 	int dflag;
 	int eflag;
+	int Eflag;
 	int fflag;
 	int lflag;
 	int vflag;
@@ -0,0 +1,243 @@
+/*
+ * Time inflate() with and without CONFIG_ZLIB_INFLATE_FAST
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Inflates each gzip file given (a legacy uImage holding a gzip image,
+ * as bootm sees it, is accepted too) with lib/zlib.c built both ways,
+ * the way lib/gunzip.c does it: gunzip() in a single inflate() call,
+ * and gunzip_stream() fed CONFIG_ZSOURCE_CHUNK bytes at a time.  The
+ * output of both builds is checked against the gzip trailer and against
+ * each other, and the best throughput of several runs is printed in MB/s
+ * of output.
+ *
+ *	zlib_bench file.gz ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "zlib_bench.h"
+
+#define IH_MAGIC	0x27051956	/* legacy uImage, see image.h */
+#define IH_HDR_SIZE	64
+#define IH_COMP_GZIP	1
+#define ZB_CHUNK	0x8000		/* CONFIG_ZSOURCE_CHUNK default */
+#define ZB_MIN_BYTES	(64 << 20)	/* inflated per measurement */
+#define ZB_RUNS		5
+
+/* Same as gunzip_header_len() in lib/gunzip.c */
+static int gzip_header_len (const unsigned char *src, unsigned long len)
+{
+	int i, flags;
+
+	if (len < 18 || src[0] != 0x1f || src[1] != 0x8b || src[2] != 8)
+		return -1;
+	flags = src[3];
+	if (flags & 0xe0)
+		return -1;
+	i = 10;
+	if (flags & 4)
+		i = 12 + src[10] + (src[11] << 8);
+	if (flags & 8)
+		while (i < len && src[i++] != 0)
+			;
+	if (flags & 0x10)
+		while (i < len && src[i++] != 0)
+			;
+	if (flags & 2)
+		i += 2;
+
+	return i < len ? i : -1;
+}
+
+static unsigned long get_le32 (const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned long get_be32 (const unsigned char *p)
+{
+	return ((unsigned long)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static double now_ns (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Inflate src into dst, chunk bytes of input at a time (0: all at once) */
+static long inflate_one (const struct zlib_bench_ops *ops,
+			 unsigned char *dst, unsigned long dstlen,
+			 unsigned char *src, unsigned long srclen,
+			 unsigned long chunk)
+{
+	z_stream s;
+	unsigned long pos = 0, n;
+	int r;
+
+	memset(&s, 0, sizeof(s));
+	s.outcb = Z_NULL;
+	if (ops->init(&s, -MAX_WBITS, ZLIB_VERSION, sizeof(s)) != Z_OK)
+		return -1;
+	s.next_out = dst;
+	s.avail_out = dstlen;
+
+	do {
+		n = (chunk && srclen - pos > chunk) ? chunk : srclen - pos;
+		s.next_in = src + pos;
+		s.avail_in = n;
+		r = ops->run(&s, chunk ? Z_NO_FLUSH : Z_FINISH);
+		pos += n - s.avail_in;
+	} while (r == Z_OK && pos < srclen);
+
+	ops->end(&s);
+
+	return r == Z_STREAM_END ? (long)(s.next_out - dst) : -1;
+}
+
+static double bench_one (const struct zlib_bench_ops *ops,
+			 unsigned char *dst, unsigned long dstlen,
+			 unsigned char *src, unsigned long srclen,
+			 unsigned long chunk)
+{
+	unsigned long done = 0;
+	double t0 = now_ns();
+
+	do {
+		done += inflate_one(ops, dst, dstlen, src, srclen, chunk);
+	} while (done < ZB_MIN_BYTES);
+
+	return done / (now_ns() - t0) * 1e3;	/* MB/s */
+}
+
+static int bench_file (const char *name)
+{
+	static const struct zlib_bench_ops *ops[] = {
+		&zlib_bench_ref, &zlib_bench_fast
+	};
+	static const unsigned long chunks[] = { 0, ZB_CHUNK };
+	unsigned char *img, *src, *out[2];
+	unsigned long len, srclen, size;
+	double mbs[2];
+	int hdr, i, c, r;
+	long got;
+	FILE *f;
+
+	if (!(f = fopen(name, "rb"))) {
+		perror(name);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	img = malloc(len);
+	if (!img || fread(img, 1, len, f) != len) {
+		fprintf(stderr, "%s: read error\n", name);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	src = img;
+	if (len > IH_HDR_SIZE && get_be32(img) == IH_MAGIC) {
+		if (img[31] != IH_COMP_GZIP) {
+			fprintf(stderr, "%s: uImage is not gzip compressed\n",
+				name);
+			return -1;
+		}
+		src += IH_HDR_SIZE;
+		len = get_be32(img + 12);	/* ih_size */
+	}
+	if ((hdr = gzip_header_len(src, len)) < 0) {
+		fprintf(stderr, "%s: not a gzip file\n", name);
+		return -1;
+	}
+	size = get_le32(src + len - 4);
+	srclen = len - hdr - 8;
+	src += hdr;
+
+	for (i = 0; i < 2; i++) {
+		out[i] = malloc(size + 1);
+		got = inflate_one(ops[i], out[i], size + 1, src, srclen, 0);
+		if (got != size || crc32(0, out[i], size) !=
+				   get_le32(src + srclen)) {
+			fprintf(stderr, "%s: %s build: bad output\n",
+				name, ops[i]->name);
+			return -1;
+		}
+		got = inflate_one(ops[i], out[i], size + 1, src, srclen,
+				  ZB_CHUNK);
+		if (got != size || crc32(0, out[i], size) !=
+				   get_le32(src + srclen)) {
+			fprintf(stderr, "%s: %s build: bad streamed output\n",
+				name, ops[i]->name);
+			return -1;
+		}
+	}
+	if (memcmp(out[0], out[1], size)) {
+		fprintf(stderr, "%s: outputs differ\n", name);
+		return -1;
+	}
+
+	printf("%s: %lu -> %lu bytes (%.0f%%)\n", name, srclen, size,
+		100.0 * srclen / size);
+	/* Best of ZB_RUNS, alternating between the builds */
+	for (c = 0; c < 2; c++) {
+		mbs[0] = mbs[1] = 0;
+		for (r = 0; r < ZB_RUNS; r++) {
+			for (i = 0; i < 2; i++) {
+				double t = bench_one(ops[i], out[i], size + 1,
+						     src, srclen, chunks[c]);
+				if (t > mbs[i])
+					mbs[i] = t;
+			}
+		}
+		printf("  %-9s %7.1f MB/s -> %7.1f MB/s (%+.0f%%)\n",
+			chunks[c] ? "streamed" : "gunzip", mbs[0], mbs[1],
+			100.0 * (mbs[1] - mbs[0]) / mbs[0]);
+	}
+
+	free(out[0]);
+	free(out[1]);
+	free(img);
+
+	return 0;
+}
+
+int main (int argc, char **argv)
+{
+	int i, ret = EXIT_SUCCESS;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s file.gz ...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (i = 1; i < argc; i++)
+		if (bench_file(argv[i]))
+			ret = EXIT_FAILURE;
+
+	return ret;
+}
@@ -0,0 +1,39 @@
+/*
+ * lib/zlib.c built twice for tools/zlib_bench, with and without
+ * CONFIG_ZLIB_INFLATE_FAST; ZLIB_BENCH_PFX keeps the two apart.
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef _ZLIB_BENCH_H_
+#define _ZLIB_BENCH_H_
+
+#include "u-boot/zlib.h"
+
+struct zlib_bench_ops {
+	const char *name;
+	int (*init)(z_streamp strm, int windowBits, const char *version,
+		    int stream_size);
+	int (*run)(z_streamp strm, int flush);	/* inflate() */
+	int (*end)(z_streamp strm);
+};
+
+extern const struct zlib_bench_ops zlib_bench_ref, zlib_bench_fast;
+
+#endif /* _ZLIB_BENCH_H_ */
@@ -0,0 +1,58 @@
+/*
+ * lib/zlib.c for tools/zlib_bench, built once as zlib_bench_ref.o and
+ * once with CONFIG_ZLIB_INFLATE_FAST as zlib_bench_fast.o
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+/* Give the global symbols of each build their own names */
+#define ZB_CAT(pfx, name)	pfx##_##name
+#define ZB_XCAT(pfx, name)	ZB_CAT(pfx, name)
+#define inflate_fast		ZB_XCAT(ZLIB_BENCH_PFX, inflate_fast)
+#define inflate_table		ZB_XCAT(ZLIB_BENCH_PFX, inflate_table)
+#define inflateReset		ZB_XCAT(ZLIB_BENCH_PFX, inflateReset)
+#define inflateInit2_		ZB_XCAT(ZLIB_BENCH_PFX, inflateInit2_)
+#define inflateInit_		ZB_XCAT(ZLIB_BENCH_PFX, inflateInit_)
+#define inflate			ZB_XCAT(ZLIB_BENCH_PFX, inflate)
+#define inflateEnd		ZB_XCAT(ZLIB_BENCH_PFX, inflateEnd)
+#define zcalloc			ZB_XCAT(ZLIB_BENCH_PFX, zcalloc)
+#define zcfree			ZB_XCAT(ZLIB_BENCH_PFX, zcfree)
+#define adler32			ZB_XCAT(ZLIB_BENCH_PFX, adler32)
+#define z_errmsg		ZB_XCAT(ZLIB_BENCH_PFX, z_errmsg)
+
+#include "../lib/zlib.c"
+#include "zlib_bench.h"
+
+const struct zlib_bench_ops ZB_XCAT(zlib_bench, ZLIB_BENCH_PFX) = {
+#ifdef CONFIG_ZLIB_INFLATE_FAST
+	.name		= "fast",
+#else
+	.name		= "ref",
+#endif
+	.init		= inflateInit2_,
+	.run		= inflate,
+	.end		= inflateEnd,
+};